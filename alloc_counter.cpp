@@ -0,0 +1,69 @@
+#include "alloc_counter.h"
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+
+static std::atomic<unsigned long> allocations(0);
+
+#if defined(__GLIBC__) && defined(EYE_TRACKING_COUNT_ALLOCS)
+/*
+ * Interpose the C allocator, operator new and cv::fastMalloc both end up here.
+ * Every allocation on every thread bumps one shared counter, so production
+ * builds leave this out.
+ */
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+
+void *malloc(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+    // a power of two multiple of sizeof(void *)
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    void *p = memalign(alignment, size);
+    if (!p) {
+        return ENOMEM;
+    }
+    *ptr = p;
+    return 0;
+}
+}
+
+bool allocation_counting() {
+    return true;
+}
+#else
+bool allocation_counting() {
+    return false;
+}
+#endif
+
+unsigned long allocation_count() {
+    return allocations.load(std::memory_order_relaxed);
+}
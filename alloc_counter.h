@@ -0,0 +1,13 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+/*
+ * Heap allocations (malloc, new and OpenCV's aligned buffers) made by the
+ * process so far. Counting needs alloc_counter.cpp built with
+ * EYE_TRACKING_COUNT_ALLOCS and glibc, as the bench always is, otherwise
+ * allocation_counting() is false and the count stays 0.
+ */
+unsigned long allocation_count();
+bool allocation_counting();
+
+#endif
@@ -0,0 +1,264 @@
+#include "batch.h"
+#include <atomic>
+#include <cctype>
+#include <climits>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <sys/stat.h>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/objdetect/objdetect.hpp>
+#include "cascade_cache.h"
+#include "constants.h"
+#include "face_tracker.h"
+#include "pipeline.h"
+#include "replay.h"
+#include "thread_pool.h"
+
+using namespace std;
+using namespace cv;
+
+/*
+ * One input and the segments of its results waiting for the ones before
+ * them to be written
+ */
+struct BatchInput {
+    string name;
+    vector<String> images;
+    bool video = false;
+    ofstream out;
+    std::mutex mutex;
+    map<int, string> pending;
+    int next_part = 0;
+};
+
+struct BatchSegment {
+    int input;
+    // position among the input's segments
+    int part;
+    int first;
+    int count;
+};
+
+/*
+ * Detection state one worker reuses from segment to segment, including the
+ * video it read last so consecutive segments don't seek
+ */
+struct BatchWorker {
+    CascadeClassifier cascade;
+    unique_ptr<FaceTracker> tracker;
+    FrameJob job;
+    int input = -1;
+    int next_frame = 0;
+    VideoCapture cap;
+};
+
+static string output_name(const string &output_dir, const string &input) {
+    string name = input;
+    while (name.size() > 1 && name[name.size() - 1] == '/') {
+        name.erase(name.size() - 1);
+    }
+    for (char &c : name) {
+        if (!isalnum((unsigned char)c) && c != '.' && c != '-' && c != '_') {
+            c = '_';
+        }
+    }
+    return output_dir + "/" + name + ".csv";
+}
+
+static void write_row(ostream &out, const FrameJob &job) {
+    if (job.faces.size() > 0) {
+        const Rect &face = job.faces[0];
+        out << job.index << "," << face.x << "," << face.y << "," << face.width << "," << face.height << ","
+            << job.left_pupil.x + face.x << "," << job.left_pupil.y + face.y << ","
+            << job.right_pupil.x + face.x << "," << job.right_pupil.y + face.y << "\n";
+    } else {
+        out << job.index << ",-1,-1,-1,-1,-1,-1,-1,-1\n";
+    }
+}
+
+/*
+ * Opens name with the next read returning frame first. Seeking isn't frame
+ * exact on every backend, so the position is checked and made up by
+ * grabbing forward, from the start if the seek overshot.
+ * returns false if the video ends before first
+ */
+static bool seek_frame(VideoCapture &cap, const string &name, int first) {
+    cap.release();
+    if (!cap.open(name)) {
+        return false;
+    }
+    int position = 0;
+    if (first > 0) {
+        cap.set(CAP_PROP_POS_FRAMES, first);
+        position = (int)cap.get(CAP_PROP_POS_FRAMES);
+        if (position < 0 || position > first) {
+            cap.release();
+            if (!cap.open(name)) {
+                return false;
+            }
+            position = 0;
+        }
+    }
+    for (; position < first; position++) {
+        if (!cap.grab()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool run_batch(const vector<string> &input_names, const string &output_dir, const string &cascade_name,
+               int threads, BatchStats *stats) {
+    double start_ticks = getTickCount();
+    if (threads <= 0) {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+
+    mkdir(output_dir.c_str(), 0755);
+    vector<unique_ptr<BatchInput> > inputs;
+    vector<BatchSegment> segments;
+    for (const string &name : input_names) {
+        unique_ptr<BatchInput> input(new BatchInput());
+        input->name = name;
+        int frames;
+        if (list_images(name, input->images)) {
+            frames = input->images.size();
+        } else {
+            VideoCapture cap;
+            if (!cap.open(name)) {
+                cerr << "Failed to open <" << name << ">!" << endl;
+                return false;
+            }
+            input->video = true;
+            // without a frame count the video can't be cut, one worker reads it all
+            frames = (int)cap.get(CAP_PROP_FRAME_COUNT);
+        }
+        string out_name = output_name(output_dir, name);
+        input->out.open(out_name.c_str());
+        if (!input->out) {
+            cerr << "Failed to open <" << out_name << ">!" << endl;
+            return false;
+        }
+        input->out << "frame,face_x,face_y,face_w,face_h,left_x,left_y,right_x,right_y\n";
+
+        int index = inputs.size();
+        if (input->video && frames <= 0) {
+            BatchSegment segment = {index, 0, 0, INT_MAX};
+            segments.push_back(segment);
+        }
+        for (int first = 0, part = 0; first < frames; first += kBatchSegmentFrames, part++) {
+            BatchSegment segment = {index, part, first, min(kBatchSegmentFrames, frames - first)};
+            // many containers only estimate the frame count, the last segment
+            // of a video reads on to wherever it really ends
+            if (input->video && first + kBatchSegmentFrames >= frames) {
+                segment.count = INT_MAX;
+            }
+            segments.push_back(segment);
+        }
+        inputs.push_back(move(input));
+    }
+
+    unique_ptr<ThreadPool> pool;
+    if (threads > 1) {
+        pool.reset(new ThreadPool(threads - 1));
+    }
+    int worker_count = pool ? pool->size() + 1 : 1;
+    vector<BatchWorker> workers(worker_count);
+
+    // the first load writes the cache, the rest read it side by side
+    if (!load_cascade(workers[0].cascade, cascade_name, kCascadeCacheDir)) {
+        cerr << "Failed to load <" << cascade_name << ">!" << endl;
+        return false;
+    }
+    atomic<bool> loaded(true);
+    auto load_worker = [&](int w) {
+        if (w > 0 && !load_cascade(workers[w].cascade, cascade_name, kCascadeCacheDir)) {
+            loaded = false;
+        }
+        workers[w].tracker.reset(new FaceTracker(workers[w].cascade));
+    };
+    if (pool) {
+        pool->parallel_for(worker_count, load_worker);
+    } else {
+        load_worker(0);
+    }
+    if (!loaded) {
+        cerr << "Failed to load <" << cascade_name << ">!" << endl;
+        return false;
+    }
+
+    atomic<long> total_frames(0), total_faces(0);
+    auto run_segment = [&](int s, int w) {
+        const BatchSegment &segment = segments[s];
+        BatchInput &input = *inputs[segment.input];
+        BatchWorker &worker = workers[w];
+        FrameJob &job = worker.job;
+
+        bool positioned = true;
+        if (input.video && (worker.input != segment.input || worker.next_frame != segment.first)) {
+            positioned = seek_frame(worker.cap, input.name, segment.first);
+            worker.input = segment.input;
+        }
+
+        stringstream rows;
+        long frames = 0, faces = 0;
+        for (int i = segment.first; positioned && i - segment.first < segment.count; i++) {
+            if (input.video) {
+                if (!worker.cap.read(job.frame)) {
+                    break;
+                }
+            } else {
+                job.frame = imread(input.images[i]);
+                if (job.frame.empty()) {
+                    continue;
+                }
+            }
+            job.index = i;
+            detect_faces(*worker.tracker, job);
+            locate_pupils(job);
+            write_row(rows, job);
+            frames++;
+            faces += job.faces.size() > 0;
+        }
+        worker.next_frame = segment.first + frames;
+        total_frames += frames;
+        total_faces += faces;
+
+        // written once every earlier segment of the input has been
+        lock_guard<std::mutex> lock(input.mutex);
+        input.pending[segment.part] = rows.str();
+        map<int, string>::iterator next;
+        while ((next = input.pending.find(input.next_part)) != input.pending.end()) {
+            input.out << next->second;
+            input.pending.erase(next);
+            input.next_part++;
+        }
+    };
+    if (pool) {
+        pool->work_stealing_for(segments.size(), run_segment);
+    } else {
+        for (size_t s = 0; s < segments.size(); s++) {
+            run_segment(s, 0);
+        }
+    }
+
+    bool written = true;
+    for (unique_ptr<BatchInput> &input : inputs) {
+        input->out.close();
+        written = written && !input->out.fail();
+    }
+
+    if (stats) {
+        stats->inputs = inputs.size();
+        stats->threads = worker_count;
+        stats->frames = total_frames;
+        stats->faces = total_faces;
+        stats->seconds = (getTickCount() - start_ticks) / getTickFrequency();
+        stats->framesPerSecond = stats->seconds > 0.0 ? stats->frames / stats->seconds : 0.0;
+    }
+    return written;
+}
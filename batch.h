@@ -0,0 +1,33 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+
+/*
+ * What run_batch() got through
+ */
+typedef struct {
+    int inputs = 0;
+    int threads = 0;
+    long frames = 0;
+    long faces = 0;
+    double seconds = 0.0;
+    double framesPerSecond = 0.0;
+} BatchStats;
+
+/*
+ * Finds the face and pupils in every frame of recorded inputs (videos,
+ * image directories or globs) on all cores. Each input is cut into
+ * segments of kBatchSegmentFrames frames, shared out with
+ * ThreadPool::work_stealing_for, and every worker detects with its own
+ * copy of the cascade. Each input's results go to
+ * output_dir/<input name>.csv in frame order.
+ *
+ * threads: workers, 0 for one per hardware thread
+ * returns false if the cascade, an input or an output file can't be opened
+ */
+bool run_batch(const std::vector<std::string> &inputs, const std::string &output_dir,
+               const std::string &cascade_name, int threads = 0, BatchStats *stats = NULL);
+
+#endif
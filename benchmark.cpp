@@ -0,0 +1,252 @@
+#include <iostream>
+#include <fstream>
+#include <opencv2/objdetect/objdetect.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include "opencv2/imgproc/imgproc.hpp"
+#include "constants.h"
+#include "eye_center.h"
+#include "gradient_voting.h"
+#include "alloc_counter.h"
+#include "luma.h"
+#include "synthetic_eye.h"
+
+using namespace std;
+using namespace cv;
+
+/*
+ * Microbenchmarks for the per-frame pipeline stages, on crops of
+ * screen_test.png and synthetic eye patches
+ *
+ * Syntax: Eye_Tracking_Bench [--image IMAGE] [--cascade CASCADE_XML]
+ *                            [--min-time SECONDS] [--json FILE]
+ */
+
+typedef struct {
+    string stage;
+    string input;
+    long iterations;
+    double nsPerOp;
+    double opsPerSec;
+    double allocsPerOp;
+} BenchResult;
+
+vector<BenchResult> results;
+double min_seconds = 0.5;
+
+/*
+ * Runs op until min_seconds have passed, after one untimed warm up call
+ */
+template <typename Op>
+void bench(const string &stage, const string &input, Op op) {
+    op();
+
+    long iterations = 0;
+    unsigned long start_allocs = allocation_count();
+    double start = getTickCount();
+    double elapsed = 0.0;
+    do {
+        op();
+        iterations++;
+        elapsed = (getTickCount() - start) / getTickFrequency();
+    } while (elapsed < min_seconds);
+    unsigned long allocs = allocation_count() - start_allocs;
+
+    BenchResult r;
+    r.stage = stage;
+    r.input = input;
+    r.iterations = iterations;
+    r.nsPerOp = elapsed * 1e9 / iterations;
+    r.opsPerSec = iterations / elapsed;
+    r.allocsPerOp = allocation_counting() ? (double)allocs / iterations : -1.0;
+    results.push_back(r);
+
+    cout << stage << " [" << input << "]: " << r.nsPerOp << " ns/op, " << r.opsPerSec << " /s, "
+         << r.allocsPerOp << " allocs/op" << endl;
+}
+
+void bench_locator_modes(const string &input, const Mat &image, Rect region) {
+    const LocatorSettingsSt defaults = LocatorSettings;
+    VoteEngine engines[] = {VOTE_REFERENCE, VOTE_SCALAR, resolve_vote_engine(VOTE_AUTO)};
+    for (VoteEngine engine : engines) {
+        LocatorSettings = defaults;
+        LocatorSettings.voteEngine = engine;
+        bench(string("find_centers/") + vote_engine_name(engine), input, [&]() { find_centers(image, region); });
+    }
+
+    // VOTE_AUTO takes the compile-time sized kernels when the patch fits one
+    LocatorSettings = defaults;
+    LocatorSettings.voteEngine = VOTE_AUTO;
+    bench("find_centers/auto", input, [&]() { find_centers(image, region); });
+
+    LocatorSettings = defaults;
+    LocatorSettings.sparseGradients = true;
+    bench("find_centers/sparse", input, [&]() { find_centers(image, region); });
+
+    LocatorSettings = defaults;
+    LocatorSettings.pyramid = true;
+    bench("find_centers/pyramid", input, [&]() { find_centers(image, region); });
+
+    LocatorSettings = defaults;
+    LocatorSettings.fftObjective = true;
+    bench("find_centers/fft", input, [&]() { find_centers(image, region); });
+
+    LocatorSettings = defaults;
+    LocatorSettings.darkWeight = true;
+    bench("find_centers/weighted", input, [&]() { find_centers(image, region); });
+
+    LocatorSettings = defaults;
+    LocatorSettings.parallelVotes = true;
+    bench("find_centers/parallel", input, [&]() { find_centers(image, region); });
+
+    // higher resolution eyes are where splitting the candidate rows pays
+    LocatorSettings = defaults;
+    LocatorSettings.eyeWidth = kFftEyeWidth;
+    bench("find_centers/wide", input, [&]() { find_centers(image, region); });
+    LocatorSettings.parallelVotes = true;
+    bench("find_centers/wide_parallel", input, [&]() { find_centers(image, region); });
+
+    Mat eye_gray, weight;
+    scale(image(region), eye_gray, kFastEyeWidth);
+    if (eye_gray.channels() > 1) {
+        cvtColor(eye_gray, eye_gray, COLOR_BGR2GRAY);
+    }
+    bench("dark_weight", input, [&]() { dark_weight(eye_gray, weight); });
+
+    LocatorSettings = defaults;
+}
+
+void write_json(ostream &out) {
+    out << "{\"allocation_counting\": " << (allocation_counting() ? "true" : "false") << ", \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        out << "  {\"stage\": \"" << r.stage << "\", \"input\": \"" << r.input << "\", \"iterations\": " << r.iterations
+            << ", \"ns_per_op\": " << r.nsPerOp << ", \"ops_per_sec\": " << r.opsPerSec
+            << ", \"allocs_per_op\": " << r.allocsPerOp << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]}\n";
+}
+
+int main(int argc, char* argv[]) {
+    string image_name = "screen_test.png";
+    string cascade_name = "haar_data/haarcascade_frontalface_alt.xml";
+    string json_name;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && string("--image").compare(argv[i]) == 0) {
+            image_name = argv[++i];
+        } else if (i + 1 < argc && string("--cascade").compare(argv[i]) == 0) {
+            cascade_name = argv[++i];
+        } else if (i + 1 < argc && string("--min-time").compare(argv[i]) == 0) {
+            min_seconds = atof(argv[++i]);
+        } else if (i + 1 < argc && string("--json").compare(argv[i]) == 0) {
+            json_name = argv[++i];
+        } else {
+            cerr << "ERROR: No argument <" << argv[i] << "> exists!\n" <<
+                    "Syntax Eye_Tracking_Bench [--image IMAGE] [--cascade CASCADE_XML] [--min-time SECONDS] [--json FILE]";
+            exit(1);
+        }
+    }
+
+    // clean synthetic patches, each from the same seed so runs compare, the
+    // locator scales each to kFastEyeWidth
+    const int widths[] = {24, 50, 96, 160};
+    for (int width : widths) {
+        SyntheticEyeSpec spec;
+        spec.width = width;
+        mt19937 rng(1);
+        Mat eye;
+        Point2f center;
+        render_synthetic_eye(spec, rng, eye, center);
+        Mat eye_gray;
+        cvtColor(eye, eye_gray, COLOR_BGR2GRAY);
+        string input = "synthetic_" + to_string(width);
+
+        bench("computeMatXGradient", input, [&]() { computeMatXGradient(eye_gray); });
+        Mat gradient_x, gradient_y;
+        bench("compute_gradients", input, [&]() { compute_gradients(eye_gray, gradient_x, gradient_y); });
+        bench_locator_modes(input, eye, Rect(0, 0, eye.cols, eye.rows));
+    }
+
+    Mat frame = imread(image_name);
+    if (frame.empty()) {
+        cerr << "Failed to open <" << image_name << ">!";
+        exit(1);
+    }
+    Mat gray_image;
+    cvtColor(frame, gray_image, COLOR_BGR2GRAY);
+
+    CascadeClassifier face_cascade;
+    if (!face_cascade.load(cascade_name)) {
+        cerr << "Failed to load <" << cascade_name << ">!";
+        exit(1);
+    }
+
+    vector<Rect> faces;
+    face_cascade.detectMultiScale(gray_image, faces, 1.1, 2, 0|CV_HAAR_SCALE_IMAGE|CV_HAAR_FIND_BIGGEST_OBJECT);
+    Rect face;
+    if (faces.size() > 0) {
+        face = faces[0];
+    } else {
+        // no face in the test image, fall back to a centered crop
+        int side = min(frame.cols, frame.rows) / 2;
+        face = Rect((frame.cols - side) / 2, (frame.rows - side) / 2, side, side);
+        cerr << "No face found in <" << image_name << ">, using a centered crop" << endl;
+    }
+
+    bench("cvtColor", image_name, [&]() { cvtColor(frame, gray_image, COLOR_BGR2GRAY); });
+    bench("detectMultiScale", image_name, [&]() {
+        face_cascade.detectMultiScale(gray_image, faces, 1.1, 2, 0|CV_HAAR_SCALE_IMAGE|CV_HAAR_FIND_BIGGEST_OBJECT);
+    });
+
+    // synthetic YUYV and NV12 frames with the test image as luminance
+    Mat chroma(gray_image.size(), CV_8U, Scalar(128));
+    Mat yuyv, nv12(gray_image.rows * 3 / 2, gray_image.cols, CV_8U, Scalar(128));
+    vector<Mat> yuyv_planes;
+    yuyv_planes.push_back(gray_image);
+    yuyv_planes.push_back(chroma);
+    merge(yuyv_planes, yuyv);
+    Mat nv12_y = nv12.rowRange(0, gray_image.rows);
+    gray_image.copyTo(nv12_y);
+    Mat luma;
+    bench("luma_plane/yuyv", image_name, [&]() { luma_plane(yuyv, PIXEL_YUYV, luma); });
+    bench("luma_plane/nv12", image_name, [&]() { luma_plane(nv12, PIXEL_NV12, luma); });
+
+    // the left eye crop of the face, as find_eyes would cut it
+    Mat face_image = frame(face);
+    Rect left_eye_region(face.width * kEyePercentSide / 100, face.height * kEyePercentTop / 100,
+                         face.width * kEyePercentWidth / 100, face.height * kEyePercentHeight / 100);
+    bench_locator_modes("face_left_eye", face_image, left_eye_region);
+
+    Point left_pupil, right_pupil;
+    Rect left_eye, right_eye;
+    bench("find_eyes", image_name, [&]() { find_eyes(frame, face, left_pupil, right_pupil, left_eye, right_eye); });
+
+    // everything the frame loop does before drawing
+    bench("frame", image_name, [&]() {
+        cvtColor(frame, gray_image, COLOR_BGR2GRAY);
+        face_cascade.detectMultiScale(gray_image, faces, 1.1, 2, 0|CV_HAAR_SCALE_IMAGE|CV_HAAR_FIND_BIGGEST_OBJECT);
+        if (faces.size() > 0) {
+            find_eyes(frame, faces[0], left_pupil, right_pupil, left_eye, right_eye);
+        }
+    });
+
+    // the same on the Y plane alone, no colour conversion anywhere
+    luma_plane(nv12, PIXEL_NV12, luma);
+    bench("frame/luma", image_name, [&]() {
+        face_cascade.detectMultiScale(luma, faces, 1.1, 2, 0|CV_HAAR_SCALE_IMAGE|CV_HAAR_FIND_BIGGEST_OBJECT);
+        if (faces.size() > 0) {
+            find_eyes(luma, faces[0], left_pupil, right_pupil, left_eye, right_eye);
+        }
+    });
+
+    if (!json_name.empty()) {
+        ofstream json(json_name.c_str());
+        if (!json) {
+            cerr << "Failed to open <" << json_name << ">!";
+            exit(1);
+        }
+        write_json(json);
+    }
+
+    return 0;
+}
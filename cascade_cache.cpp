@@ -0,0 +1,204 @@
+#include "cascade_cache.h"
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include "opencv2/core/core.hpp"
+
+using namespace std;
+using namespace cv;
+
+/*
+ * A cache file is keyed on the model's path, size and modification time,
+ * so a hit never has to read the model itself
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t pathHash;
+    uint64_t sourceSize;
+    int64_t sourceMtimeSec;
+    int64_t sourceMtimeNsec;
+    uint64_t payloadSize;
+} CascadeCacheHeader;
+
+static const char cache_magic[8] = {'C', 'A', 'S', 'C', 'A', 'C', 'H', 'E'};
+static const uint32_t cache_version = 3;
+
+static bool read_file(const string &file_name, string &contents) {
+    ifstream in(file_name.c_str(), ios::binary);
+    if (!in) {
+        return false;
+    }
+    in.seekg(0, ios::end);
+    contents.resize((size_t)in.tellg());
+    in.seekg(0, ios::beg);
+    in.read(&contents[0], contents.size());
+    return (bool)in;
+}
+
+static double elapsed_ms(double start_ticks) {
+    return (getTickCount() - start_ticks) * 1000.0 / getTickFrequency();
+}
+
+// FNV-1a
+static uint64_t hash_bytes(const string &bytes) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < bytes.size(); i++) {
+        hash ^= (unsigned char)bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static string base_name(const string &path) {
+    size_t slash = path.find_last_of("/\\");
+    string name = slash == string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.rfind('.');
+    return dot == string::npos ? name : name.substr(0, dot);
+}
+
+string compact_cascade(const string &xml) {
+    string out;
+    out.reserve(xml.size() / 2);
+    bool pending_space = false;
+    for (size_t i = 0; i < xml.size(); i++) {
+        if (xml.compare(i, 4, "<!--") == 0) {
+            size_t end = xml.find("-->", i + 4);
+            if (end == string::npos) {
+                break;
+            }
+            i = end + 2;
+            continue;
+        }
+        char c = xml[i];
+        if (isspace((unsigned char)c)) {
+            pending_space = true;
+            continue;
+        }
+        // whitespace only matters between two values, never next to a tag
+        if (pending_space && c != '<' && !out.empty() && out[out.size() - 1] != '>') {
+            out += ' ';
+        }
+        pending_space = false;
+        out += c;
+    }
+    return out;
+}
+
+/*
+ * Parses model text from memory into cascade
+ */
+static bool read_cascade(CascadeClassifier &cascade, const string &text) {
+    try {
+        FileStorage fs(text, FileStorage::READ | FileStorage::MEMORY);
+        return fs.isOpened() && cascade.read(fs.getFirstTopLevelNode());
+    } catch (const cv::Exception &) {
+        return false;
+    }
+}
+
+// header as the model on disk now is, false if it can't be stat'ed
+static bool source_key(const string &model, CascadeCacheHeader &key) {
+    struct stat st;
+    if (stat(model.c_str(), &st) != 0) {
+        return false;
+    }
+    memset(&key, 0, sizeof(key));
+    memcpy(key.magic, cache_magic, sizeof(cache_magic));
+    key.version = cache_version;
+    key.pathHash = hash_bytes(model);
+    key.sourceSize = st.st_size;
+    key.sourceMtimeSec = st.st_mtime;
+#ifdef __APPLE__
+    key.sourceMtimeNsec = st.st_mtimespec.tv_nsec;
+#else
+    key.sourceMtimeNsec = st.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+/*
+ * Reads the cache file alone, header then payload, and parses the payload
+ * if the header matches key
+ */
+static bool load_cache(CascadeClassifier &cascade, const string &cache_file, const CascadeCacheHeader &key,
+                       CascadeCacheHeader &header) {
+    ifstream in(cache_file.c_str(), ios::binary);
+    if (!in || !in.read((char *)&header, sizeof(header))) {
+        return false;
+    }
+    if (memcmp(header.magic, key.magic, sizeof(key.magic)) != 0 || header.version != key.version ||
+        header.pathHash != key.pathHash || header.sourceSize != key.sourceSize ||
+        header.sourceMtimeSec != key.sourceMtimeSec || header.sourceMtimeNsec != key.sourceMtimeNsec) {
+        return false;
+    }
+    string payload;
+    payload.resize(header.payloadSize);
+    if (!in.read(&payload[0], payload.size()) || in.peek() != char_traits<char>::eof()) {
+        return false;
+    }
+    return read_cascade(cascade, payload);
+}
+
+static bool write_cache(const string &cache_dir, const string &cache_file, const string &payload,
+                        const CascadeCacheHeader &key) {
+    mkdir(cache_dir.c_str(), 0755);
+
+    CascadeCacheHeader header = key;
+    header.payloadSize = payload.size();
+
+    // written aside and renamed, so a concurrent launch never reads half a file
+    string temp_file = cache_file + ".tmp";
+    {
+        ofstream out(temp_file.c_str(), ios::binary);
+        if (!out) {
+            return false;
+        }
+        out.write((const char *)&header, sizeof(header));
+        out.write(payload.data(), payload.size());
+        if (!out) {
+            return false;
+        }
+    }
+    return rename(temp_file.c_str(), cache_file.c_str()) == 0;
+}
+
+bool load_cascade(CascadeClassifier &cascade, const string &model, const string &cache_dir, CascadeLoadInfo *info) {
+    double start = getTickCount();
+    CascadeLoadInfo result;
+
+    CascadeCacheHeader key, header;
+    bool cacheable = !cache_dir.empty() && source_key(model, key);
+    if (cacheable) {
+        stringstream name;
+        name << cache_dir << "/" << base_name(model) << "-" << hex << key.pathHash << ".cascade";
+        result.cacheFile = name.str();
+        result.fromCache = load_cache(cascade, result.cacheFile, key, header);
+    }
+
+    bool loaded = result.fromCache;
+    if (!loaded) {
+        loaded = cascade.load(model);
+
+        // the compacted model is only cached once it is known to parse
+        string source;
+        if (loaded && cacheable && read_file(model, source)) {
+            string payload = compact_cascade(source);
+            CascadeClassifier check;
+            if (read_cascade(check, payload)) {
+                result.cacheWritten = write_cache(cache_dir, result.cacheFile, payload, key);
+            }
+        }
+    }
+
+    result.milliseconds = elapsed_ms(start);
+    if (info) {
+        *info = result;
+    }
+    return loaded;
+}
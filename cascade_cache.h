@@ -0,0 +1,36 @@
+#ifndef CASCADE_CACHE_H
+#define CASCADE_CACHE_H
+
+#include <string>
+#include <opencv2/objdetect/objdetect.hpp>
+
+/*
+ * How load_cascade() got its model
+ */
+typedef struct {
+    bool fromCache = false;
+    bool cacheWritten = false;
+    std::string cacheFile;
+    double milliseconds = 0.0;
+} CascadeLoadInfo;
+
+/*
+ * Loads a cascade through a cache of compacted models in cache_dir. The
+ * cache file is named after the model and a hash of its path, and holds the
+ * model XML with comments and indentation stripped behind a small binary
+ * header keyed on the model's path, size and modification time. This is not
+ * a binary model: a hit stats the model and reads only the cache file, but
+ * FileStorage still parses the compacted XML in full, so all it saves is
+ * reading the larger file and scanning its whitespace. A missing or stale
+ * cache is rebuilt after loading the model with CascadeClassifier::load.
+ * An empty cache_dir loads the model directly.
+ *
+ * returns false if the model can't be loaded at all
+ */
+bool load_cascade(cv::CascadeClassifier &cascade, const std::string &model, const std::string &cache_dir,
+                  CascadeLoadInfo *info = NULL);
+
+// the model text without comments and with whitespace collapsed
+std::string compact_cascade(const std::string &xml);
+
+#endif
@@ -1,3 +1,5 @@
+#ifndef CONSTANTS_H
+#define CONSTANTS_H
 
 // eye size rations
 const int kEyePercentWidth = 20;
@@ -8,3 +10,63 @@ const int kEyePercentSide = 22;
 const int kScaledEyeWidth = 50;
 const double kGradientThreshold = 50.0;
 const int kFastEyeWidth = 50;
+
+// coarse to fine search: downsample factor, refined candidates, window radius
+const int kPyramidFactor = 2;
+const int kPyramidCandidates = 3;
+const int kPyramidRadius = 3;
+
+// dark pixel weight: candidates under this fraction of the darkest
+// candidate's weight are never scored
+const float kWeightCutoff = 0.5f;
+
+// parallel voting: least votes (gradients x candidates) worth a thread of
+// their own, smaller patches are voted on the calling thread alone
+const int kParallelVoteWork = 1 << 19;
+
+// approximate FFT objective: scaled eye width, candidates re-scored exactly
+const int kFftEyeWidth = 150;
+const int kFftCandidates = 8;
+
+// pupil filter, in fractions of the eye width: position and velocity gains,
+// how fast the error estimate follows, the search window radius as minimum
+// plus gain * error, and the error beyond which the filter starts over
+const float kPupilAlpha = 0.5f;
+const float kPupilBeta = 0.2f;
+const float kPupilErrorRate = 0.5f;
+const float kPupilWindowMin = 0.08f;
+const float kPupilWindowGain = 3.0f;
+const float kPupilMaxError = 0.25f;
+
+// gaze log: samples per mapped window and between asynchronous flushes
+const int kGazeLogWindowSamples = 4096;
+const int kGazeLogFlushSamples = 256;
+
+// compacted cascade XML, keyed on the source model's path, size and modification time
+const char kCascadeCacheDir[] = "haar_data/cache";
+
+// quality scheduler: weight of the newest frame time in the running average,
+// frames a level is held before it can change, and the fraction of the
+// budget the average has to drop under before quality is raised again
+const double kQualityAverageRate = 0.2;
+const int kQualityHoldFrames = 15;
+const double kQualityRecoverRatio = 0.6;
+
+// batch mode: frames per unit of work handed to a worker
+const int kBatchSegmentFrames = 120;
+
+// gaze targets: how long the gaze rests on a target before it is selected
+const double kDwellSelectMs = 800.0;
+
+// face tracking: full frame detection period, search margin (fraction of the
+// face size added on each side) and accepted size range around the last face
+const int kTrackFullDetectEvery = 30;
+const double kTrackSearchMargin = 0.5;
+const double kTrackMinScale = 0.8;
+const double kTrackMaxScale = 1.25;
+
+// multi face ids: overlap needed to keep an id, frames an unmatched id is kept
+const double kFaceMatchOverlap = 0.3;
+const int kFaceMaxMissed = 10;
+
+#endif
@@ -0,0 +1,554 @@
+#include "eye_center.h"
+#include "constants.h"
+#include "fixed_locator.h"
+#include "latency.h"
+#include "thread_pool.h"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <algorithm>
+
+using namespace std;
+using namespace cv;
+
+LocatorSettingsSt LocatorSettings;
+
+void scale(const Mat &src,Mat &dst, int width) {
+    cv::resize(src, dst, cv::Size(width,(((float)width)/src.cols) * src.rows));
+}
+
+Point unscale_point(Point p, Rect origSize, int width) {
+    float ratio = (((float)width)/origSize.width);
+    int x = round(p.x / ratio);
+    int y = round(p.y / ratio);
+    return Point(x,y);
+}
+
+Mat matrix_magnitude(Mat mat_x, Mat mat_y) {
+    Mat mag(mat_x.rows, mat_x.cols, CV_64F);
+    matrix_magnitude(mat_x, mat_y, mag);
+    return mag;
+}
+
+void matrix_magnitude(const Mat &mat_x, const Mat &mat_y, Mat &mag) {
+    for (int y = 0; y < mat_x.rows; y++) {
+        const double *x_row = mat_x.ptr<double>(y), *y_row = mat_y.ptr<double>(y);
+        double *mag_row = mag.ptr<double>(y);
+        for (int x = 0; x < mat_x.cols; x++) {
+            double gx = x_row[x], gy = y_row[x];
+            double magnitude = sqrt((gx * gx) + (gy * gy));
+            mag_row[x] = magnitude;
+        }
+    }
+}
+
+
+/*
+ * Find possible center in gradient location
+ * the weight of color (section 2.1) is applied to the sum afterwards
+ */
+void possible_centers(int x, int y, const Mat &blurred, double gx, double gy, Mat &output) {
+
+    for (int cy = 0; cy < output.rows; cy++) {
+        double *output_row = output.ptr<double>(cy);
+        for (int cx = 0; cx < output.cols; cx++) {
+            if (x == cx && y == cy) {
+                continue;
+            }
+            // equation (2)
+            double dx = x - cx;
+            double dy = y - cy;
+            double magnitude = sqrt((dx * dx) + (dy * dy));
+            dx = dx / magnitude;
+            dy = dy / magnitude;
+
+            double dotProduct = (dx*gx + dy*gy);
+            // ignores vectors pointing in opposite direction/negative dot products
+            dotProduct = max(0.0, dotProduct);
+
+            // summation
+            output_row[cx] += dotProduct * dotProduct;
+        }
+    }
+}
+
+/*
+ * Imitate Matlab gradiant function, to better match results from paper
+ */
+Mat computeMatXGradient(const Mat &mat) {
+    Mat out(mat.rows,mat.cols,CV_64F);
+    computeMatXGradient(mat, out);
+    return out;
+}
+
+void computeMatXGradient(const Mat &mat, Mat &out) {
+    for (int y = 0; y < mat.rows; ++y) {
+        const uchar *Mr = mat.ptr<uchar>(y);
+        double *Or = out.ptr<double>(y);
+
+        Or[0] = Mr[1] - Mr[0];
+        for (int x = 1; x < mat.cols - 1; ++x) {
+            Or[x] = (Mr[x+1] - Mr[x-1])/2.0;
+        }
+        Or[mat.cols-1] = Mr[mat.cols-1] - Mr[mat.cols-2];
+    }
+}
+
+EyeWorkspace::EyeWorkspace() {
+    const int n = kFastEyeWidth;
+    eye_scaled.create(n, n, CV_8UC3);
+    eye_scaled_gray.create(n, n, CV_8U);
+    transposed.create(n, n, CV_8U);
+    gradient_transposed.create(n, n, CV_64F);
+    gradient_x.create(n, n, CV_64F);
+    gradient_y.create(n, n, CV_64F);
+    magnitude.create(n, n, CV_64F);
+    gradient_x32.create(n, n, CV_32F);
+    gradient_y32.create(n, n, CV_32F);
+    magnitude32.create(n, n, CV_32F);
+    out_sum.create(n, n, CV_32F);
+    out_sum64.create(n, n, CV_64F);
+    eye_coarse.create(n, n, CV_8U);
+    coarse_sum.create(n, n, CV_32F);
+    weight.create(n, n, CV_32F);
+    gradients.reserve(n * n);
+    spans.reserve(n);
+    coarse_gradients.reserve(n * n);
+    ranked.reserve(n * n);
+    candidates.reserve(kPyramidCandidates);
+}
+
+Mat EyeWorkspace::view(Mat &buffer, int rows, int cols, int type) {
+    if (buffer.type() != type || buffer.rows < rows || buffer.cols < cols) {
+        buffer.create(max(rows, buffer.rows), max(cols, buffer.cols), type);
+    }
+    return buffer(Rect(0, 0, cols, rows));
+}
+
+/*
+ * Normalized gradients of a grey eye image, left in the workspace, CV_64F
+ * for the reference engine and CV_32F for the others
+ * gradients: optional, receives the voting list, thresholded in sparse mode
+ */
+static void eye_gradients(const Mat &eye_gray, EyeWorkspace &ws, Mat &gradient_x, Mat &gradient_y,
+                          GradientList *gradients) {
+    int rows = eye_gray.rows, cols = eye_gray.cols;
+    bool sparse = gradients && LocatorSettings.sparseGradients;
+
+    if (LocatorSettings.voteEngine != VOTE_REFERENCE) {
+        // single pass straight to normalized floats, no transposes
+        gradient_x = EyeWorkspace::view(ws.gradient_x32, rows, cols, CV_32F);
+        gradient_y = EyeWorkspace::view(ws.gradient_y32, rows, cols, CV_32F);
+        Mat magnitude;
+        double threshold = 0.0;
+        if (sparse) {
+            magnitude = EyeWorkspace::view(ws.magnitude32, rows, cols, CV_32F);
+            compute_gradients(eye_gray, gradient_x, gradient_y, &magnitude);
+            threshold = dynamic_threshold(magnitude, kGradientThreshold);
+        } else {
+            compute_gradients(eye_gray, gradient_x, gradient_y);
+        }
+        if (gradients) {
+            build_gradient_list(gradient_x, gradient_y, magnitude, threshold, *gradients);
+        }
+        return;
+    }
+
+    gradient_x = EyeWorkspace::view(ws.gradient_x, rows, cols, CV_64F);
+    gradient_y = EyeWorkspace::view(ws.gradient_y, rows, cols, CV_64F);
+
+    computeMatXGradient(eye_gray, gradient_x);
+    //Sobel(eye_gray, gradient_x, CV_64F, 1, 0, 5);
+    Mat transposed = EyeWorkspace::view(ws.transposed, cols, rows, CV_8U);
+    Mat gradient_transposed = EyeWorkspace::view(ws.gradient_transposed, cols, rows, CV_64F);
+    transpose(eye_gray, transposed);
+    computeMatXGradient(transposed, gradient_transposed);
+    transpose(gradient_transposed, gradient_y);
+    //Sobel(eye_gray, gradient_y, CV_64F, 0, 1, 5);
+
+    // drop weak gradients (flat skin, sensor noise) before they vote
+    Mat magnitude;
+    double threshold = 0.0;
+    if (sparse) {
+        magnitude = EyeWorkspace::view(ws.magnitude, rows, cols, CV_64F);
+        matrix_magnitude(gradient_x, gradient_y, magnitude);
+        threshold = dynamic_threshold(magnitude, kGradientThreshold);
+    }
+
+    // normalized displacement vectors
+    normalize(gradient_x, gradient_x);
+    normalize(gradient_y, gradient_y);
+
+    if (gradients) {
+        build_gradient_list(gradient_x, gradient_y, magnitude, threshold, *gradients);
+    }
+}
+
+/*
+ * Strongest local maxima of a vote grid, at least radius + 1 apart
+ */
+static void best_candidates(const Mat &out_sum, int count, int radius, EyeWorkspace &ws) {
+    vector<pair<float, Point> > &ranked = ws.ranked;
+    ranked.clear();
+    for (int y = 0; y < out_sum.rows; y++) {
+        const float *row = out_sum.ptr<float>(y);
+        for (int x = 0; x < out_sum.cols; x++) {
+            ranked.push_back(make_pair(row[x], Point(x, y)));
+        }
+    }
+    sort(ranked.begin(), ranked.end(), [](const pair<float, Point> &a, const pair<float, Point> &b) {
+        return a.first > b.first;
+    });
+
+    vector<Point> &candidates = ws.candidates;
+    candidates.clear();
+    for (size_t i = 0; i < ranked.size() && (int)candidates.size() < count; i++) {
+        Point p = ranked[i].second;
+        bool suppressed = false;
+        for (Point c : candidates) {
+            if (abs(c.x - p.x) <= radius && abs(c.y - p.y) <= radius) {
+                suppressed = true;
+                break;
+            }
+        }
+        if (!suppressed) {
+            candidates.push_back(p);
+        }
+    }
+}
+
+/*
+ * Coarse to fine search, votes over a downsampled eye first and then scores
+ * only small windows around the best coarse candidates at full resolution
+ * returns the center in eye_scaled_gray coordinates
+ */
+static Point pyramid_center(const Mat &eye_scaled_gray, EyeWorkspace &ws, LocatorStats *stats) {
+    Mat gradient_x, gradient_y;
+
+    // coarse level, every candidate is scored
+    Mat eye_coarse = EyeWorkspace::view(ws.eye_coarse, max(eye_scaled_gray.rows / kPyramidFactor, 3),
+                                        max(eye_scaled_gray.cols / kPyramidFactor, 3), CV_8U);
+    resize(eye_scaled_gray, eye_coarse, eye_coarse.size(), 0, 0, INTER_AREA);
+    eye_gradients(eye_coarse, ws, gradient_x, gradient_y, &ws.coarse_gradients);
+    Mat coarse_sum = EyeWorkspace::view(ws.coarse_sum, eye_coarse.rows, eye_coarse.cols, CV_32F);
+    coarse_sum.setTo(Scalar::all(0));
+    accumulate_votes(ws.coarse_gradients, coarse_sum, LocatorSettings.voteEngine);
+
+    // candidates are kept apart so their refinement windows never overlap
+    best_candidates(coarse_sum, kPyramidCandidates, kPyramidRadius, ws);
+
+    // fine level, only windows around the coarse candidates are scored
+    eye_gradients(eye_scaled_gray, ws, gradient_x, gradient_y, &ws.gradients);
+    Mat outSum = EyeWorkspace::view(ws.out_sum, eye_scaled_gray.rows, eye_scaled_gray.cols, CV_32F);
+    outSum.setTo(Scalar::all(0));
+    Rect grid(0, 0, eye_scaled_gray.cols, eye_scaled_gray.rows);
+    for (Point c : ws.candidates) {
+        Point center(c.x * kPyramidFactor + kPyramidFactor / 2, c.y * kPyramidFactor + kPyramidFactor / 2);
+        Rect window = Rect(center.x - kPyramidRadius, center.y - kPyramidRadius,
+                           2 * kPyramidRadius + 1, 2 * kPyramidRadius + 1) & grid;
+        accumulate_votes(ws.gradients, outSum, LocatorSettings.voteEngine, window);
+    }
+
+    if (stats) {
+        stats->voters = ws.gradients.size();
+        stats->gradients = eye_scaled_gray.rows * eye_scaled_gray.cols;
+        stats->windows = ws.candidates.size();
+    }
+
+    Point max_point;
+    minMaxLoc(outSum, NULL, NULL, NULL, &max_point);
+    return max_point;
+}
+
+/*
+ * Approximate search for large patches: the unclamped objective by FFT,
+ * then the exact objective on its best few candidates
+ */
+static Point fft_center(const Mat &eye_scaled_gray, EyeWorkspace &ws, LocatorStats *stats) {
+    int rows = eye_scaled_gray.rows, cols = eye_scaled_gray.cols;
+    Mat gradient_x = EyeWorkspace::view(ws.gradient_x32, rows, cols, CV_32F);
+    Mat gradient_y = EyeWorkspace::view(ws.gradient_y32, rows, cols, CV_32F);
+    compute_gradients(eye_scaled_gray, gradient_x, gradient_y);
+    build_gradient_list(gradient_x, gradient_y, Mat(), 0.0, ws.gradients);
+
+    Mat outSum = EyeWorkspace::view(ws.out_sum, rows, cols, CV_32F);
+    fft_objective(gradient_x, gradient_y, outSum);
+    best_candidates(outSum, kFftCandidates, 1, ws);
+
+    Point max_point;
+    double max_value = -1.0;
+    for (Point c : ws.candidates) {
+        double value = score_center(ws.gradients, c);
+        if (value > max_value) {
+            max_value = value;
+            max_point = c;
+        }
+    }
+
+    if (stats) {
+        stats->voters = ws.gradients.size();
+        stats->gradients = rows * cols;
+        stats->windows = ws.candidates.size();
+    }
+    return max_point;
+}
+
+Point find_centers(Mat face_image, Rect eye_region, LocatorStats *stats, PupilFilter *filter) {
+    static thread_local EyeWorkspace workspace;
+    return find_centers(face_image, eye_region, workspace, stats, filter);
+}
+
+// shared by every locating thread, the caller makes up the last core
+static ThreadPool &vote_pool() {
+    static ThreadPool pool(max(1, (int)thread::hardware_concurrency() - 1));
+    return pool;
+}
+
+/*
+ * Threads worth voting on window with, one per kParallelVoteWork votes and
+ * never more than there are cores or candidate rows
+ */
+static int vote_threads(const Rect &window, int gradients) {
+    long work = (long)gradients * window.area();
+    int cores = vote_pool().size() + 1;
+    return (int)max(1L, min(work / kParallelVoteWork, (long)min(cores, window.height)));
+}
+
+/*
+ * Single precision votes for the candidates in window, returns the number of
+ * gradients that voted
+ *
+ * In parallel every thread takes a band of candidate rows and casts every
+ * gradient's votes into it alone, so no two threads write the same sum and
+ * each sum adds up its votes in the same order as on one thread.
+ */
+static int vote_window(const Mat &gradient_x, const Mat &gradient_y, EyeWorkspace &ws, Mat &outSum,
+                       const Rect &window, const CandidateSpans *spans) {
+    outSum.setTo(Scalar::all(0));
+    bool sparse = LocatorSettings.sparseGradients;
+    int threads = 1;
+    if (LocatorSettings.parallelVotes) {
+        threads = vote_threads(window, sparse ? (int)ws.gradients.size() : gradient_x.rows * gradient_x.cols);
+    }
+
+    int voters = sparse ? (int)ws.gradients.size() : 0;
+    auto vote_band = [&](int band) {
+        Rect rows(window.x, window.y + window.height * band / threads, window.width, 0);
+        rows.height = window.y + window.height * (band + 1) / threads - rows.y;
+        if (sparse) {
+            accumulate_votes(ws.gradients, outSum, LocatorSettings.voteEngine, rows, spans);
+            return;
+        }
+        // table driven and vectorized per candidate row
+        int band_voters = accumulate_votes(gradient_x, gradient_y, outSum, LocatorSettings.voteEngine, rows, spans);
+        if (band == 0) {
+            voters = band_voters;
+        }
+    };
+    if (threads > 1) {
+        vote_pool().parallel_for(threads, vote_band);
+    } else {
+        vote_band(0);
+    }
+    return voters;
+}
+
+/*
+ * Whether p is on an edge of window that isn't an edge of grid, the true
+ * maximum may then lie outside the window
+ */
+static bool on_window_edge(Point p, const Rect &window, const Rect &grid) {
+    return (p.x == window.x && window.x > grid.x) ||
+           (p.y == window.y && window.y > grid.y) ||
+           (p.x == window.br().x - 1 && window.br().x < grid.br().x) ||
+           (p.y == window.br().y - 1 && window.br().y < grid.br().y);
+}
+
+/*
+ * Finds the pupils within the given eye region
+ * returns points of where pupil is calculated to be
+ *
+ * face_image: image of face region from frame
+ * eye_region: dimensions of eye region
+ * ws: buffers reused between calls, nothing is allocated once it is warm
+ * stats: optional, receives the number of gradients that voted
+ * filter: optional, with LocatorSettings.predictive only candidates around
+ *         its prediction are scored and the smoothed pupil is returned
+ */
+Point find_centers(const Mat &face_image, Rect eye_region, EyeWorkspace &ws, LocatorStats *stats,
+                   PupilFilter *filter) {
+    LatencyTimer timer(LATENCY_LOCATE);
+
+    Mat eye_unscaled = face_image(eye_region);
+
+    // scale and grey image
+    int eye_width = LocatorSettings.fftObjective ? kFftEyeWidth : LocatorSettings.eyeWidth;
+    int rows = (((float)eye_width)/eye_unscaled.cols) * eye_unscaled.rows;
+    Mat eye_scaled = EyeWorkspace::view(ws.eye_scaled, rows, eye_width, eye_unscaled.type());
+    Mat eye_scaled_gray = EyeWorkspace::view(ws.eye_scaled_gray, rows, eye_width, CV_8U);
+    scale(eye_unscaled, eye_scaled, eye_width);
+    if (eye_scaled.channels() == 1) {
+        eye_scaled.copyTo(eye_scaled_gray);
+    } else {
+        cvtColor(eye_scaled, eye_scaled_gray, COLOR_BGRA2GRAY);
+    }
+
+    // candidate centers worth scoring, the reference engine always scores all
+    bool predictive = filter && LocatorSettings.predictive;
+    Rect grid(0, 0, eye_width, rows);
+    Rect window = grid;
+    if (predictive && LocatorSettings.voteEngine != VOTE_REFERENCE) {
+        window = filter->predict(eye_width) & grid;
+        if (window.area() == 0) {
+            window = grid;
+        }
+    }
+
+    // compile-time sized kernels for the common patch sizes, unless the patch
+    // is big enough to vote on across cores
+    bool parallel = LocatorSettings.parallelVotes && vote_threads(grid, grid.area()) > 1;
+    FixedLocatorFn fixed = NULL;
+    if (LocatorSettings.voteEngine == VOTE_AUTO && !LocatorSettings.sparseGradients && !LocatorSettings.darkWeight &&
+        !parallel && window == grid) {
+        fixed = fixed_locator(eye_scaled_gray.cols, eye_scaled_gray.rows);
+    }
+
+    Point max_point;
+    if (LocatorSettings.fftObjective) {
+        max_point = fft_center(eye_scaled_gray, ws, stats);
+    } else if (LocatorSettings.pyramid) {
+        max_point = pyramid_center(eye_scaled_gray, ws, stats);
+    } else if (fixed) {
+        int voters = 0;
+        max_point = fixed(eye_scaled_gray, &voters);
+        if (stats) {
+            stats->voters = voters;
+            stats->gradients = eye_scaled_gray.rows * eye_scaled_gray.cols;
+        }
+    } else {
+        // get the gradient of eye regions
+        Mat gradient_x, gradient_y;
+        eye_gradients(eye_scaled_gray, ws, gradient_x, gradient_y, LocatorSettings.sparseGradients ? &ws.gradients : NULL);
+
+        // the blurred, inverted eye is the paper's weight (section 2.1), light
+        // candidates (skin, eyelids) get no votes cast, except by the reference
+        // engine, which scores every candidate and weighs them afterwards
+        const Mat &blurred = eye_scaled_gray;
+        Mat weight;
+        float cut_off = 0.0f;
+        const CandidateSpans *spans = NULL;
+        int candidates = 0;
+        if (LocatorSettings.darkWeight) {
+            weight = EyeWorkspace::view(ws.weight, rows, eye_width, CV_32F);
+            dark_weight(eye_scaled_gray, weight);
+            double max_weight = 0.0;
+            minMaxLoc(weight, NULL, &max_weight);
+            cut_off = kWeightCutoff * (float)max_weight;
+            candidates = candidate_spans(weight, cut_off, ws.spans);
+            spans = &ws.spans;
+        }
+
+        Mat outSum;
+        int voters = 0;
+        if (LocatorSettings.voteEngine == VOTE_REFERENCE) {
+            outSum = EyeWorkspace::view(ws.out_sum64, rows, eye_width, CV_64F);
+            outSum.setTo(Scalar::all(0));
+            if (LocatorSettings.sparseGradients) {
+                voters = ws.gradients.size();
+                for (const GradientEntry &g : ws.gradients) {
+                    possible_centers(g.x, g.y, blurred, g.gx, g.gy, outSum);
+                }
+            } else {
+                for (int y = 0; y < blurred.rows; y++) {
+                    const double *x_row = gradient_x.ptr<double>(y), *y_row = gradient_y.ptr<double>(y);
+                    for (int x = 0; x < blurred.cols; x++) {
+                        double gx = x_row[x], gy = y_row[x];
+                        if (gx == 0.0 && gy == 0.0) {
+                            continue;
+                        }
+                        voters++;
+                        possible_centers(x, y, blurred, gx, gy, outSum);
+                    }
+                }
+            }
+        } else {
+            outSum = EyeWorkspace::view(ws.out_sum, rows, eye_width, CV_32F);
+            voters = vote_window(gradient_x, gradient_y, ws, outSum, window, spans);
+        }
+        if (spans) {
+            apply_weight(outSum, weight, cut_off);
+        }
+
+        // averaging over the gradient count doesn't move the maximum
+        minMaxLoc(outSum(window), NULL, NULL, NULL, &max_point);
+        max_point += window.tl();
+
+        // pupil moved further than predicted, score everything after all
+        if (window != grid && on_window_edge(max_point, window, grid)) {
+            window = grid;
+            voters = vote_window(gradient_x, gradient_y, ws, outSum, window, spans);
+            if (spans) {
+                apply_weight(outSum, weight, cut_off);
+            }
+            minMaxLoc(outSum, NULL, NULL, NULL, &max_point);
+        }
+
+        if (stats) {
+            stats->voters = voters;
+            stats->gradients = eye_scaled_gray.rows * eye_scaled_gray.cols;
+            stats->windows = window == grid ? 0 : 1;
+            stats->candidates = candidates;
+        }
+    }
+
+    if (predictive) {
+        max_point = filter->update(max_point, eye_width);
+    }
+    return unscale_point(max_point, eye_region, eye_width);
+}
+
+void eye_regions(Rect face, Rect &left_eye_region, Rect &right_eye_region) {
+    int eye_width = face.width * (kEyePercentWidth/100.0);
+    int eye_height = face.height * (kEyePercentHeight/100.0);
+    int eye_top = face.height * (kEyePercentTop/100.0);
+    int eye_side = face.width * (kEyePercentSide/100.0);
+    int right_eye_x = face.width - eye_width -  eye_side;
+
+    left_eye_region = Rect(eye_side, eye_top, eye_width, eye_height);
+    right_eye_region = Rect(right_eye_x, eye_top, eye_width, eye_height);
+}
+
+/*
+ * returns an array of points of the pupils
+ * [left pupil, right pupil]
+ *
+ * color_image: image of the whole frame
+ * face: dimensions of face in color_image
+ * left_stats, right_stats: optional per eye locator figures
+ */
+void find_eyes(Mat color_image, Rect face, Point &left_pupil_dst, Point &right_pupil_dst, Rect &left_eye_region_dst, Rect &right_eye_region_dst,
+               LocatorStats *left_stats, LocatorStats *right_stats, EyeFilters *filters) {
+    // image of face
+    Mat face_image = color_image(face);
+
+    // eye regions
+    Rect left_eye_region, right_eye_region;
+    eye_regions(face, left_eye_region, right_eye_region);
+
+    // get points of pupils within eye region
+    static thread_local EyeWorkspace left_workspace, right_workspace;
+    Point left_pupil = find_centers(face_image, left_eye_region, left_workspace, left_stats,
+                                    filters ? &filters->left : NULL);
+    Point right_pupil = find_centers(face_image, right_eye_region, right_workspace, right_stats,
+                                     filters ? &filters->right : NULL);
+
+    // convert points to fit on frame image
+    right_pupil.x += right_eye_region.x;
+    right_pupil.y += right_eye_region.y;
+    left_pupil.x += left_eye_region.x;
+    left_pupil.y += left_eye_region.y;
+
+
+    left_pupil_dst = left_pupil;
+    right_pupil_dst = right_pupil;
+    left_eye_region_dst = left_eye_region;
+    right_eye_region_dst = right_eye_region;
+}
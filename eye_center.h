@@ -0,0 +1,82 @@
+#ifndef EYE_CENTER_H
+#define EYE_CENTER_H
+
+#include <opencv2/core/core.hpp>
+#include "constants.h"
+#include "gradient_voting.h"
+#include "pupil_filter.h"
+
+typedef struct {
+    VoteEngine voteEngine = VOTE_AUTO;
+    // only vote with gradients above the dynamic magnitude threshold
+    bool sparseGradients = false;
+    // coarse to fine search instead of scoring every candidate
+    bool pyramid = false;
+    // approximate FFT objective on a kFftEyeWidth eye, best candidates re-scored
+    bool fftObjective = false;
+    // score only candidates around each pupil's predicted position
+    bool predictive = false;
+    // weight each candidate by how dark it is (section 2.1), skipping light ones
+    bool darkWeight = false;
+    // split the candidate rows across cores, as many as the patch size pays for
+    bool parallelVotes = false;
+    // width eyes are scaled to before locating, lowered by the quality scheduler
+    int eyeWidth = kFastEyeWidth;
+} LocatorSettingsSt;
+extern LocatorSettingsSt LocatorSettings;
+
+/*
+ * Per eye figures reported back from find_centers
+ */
+typedef struct {
+    int voters = 0;
+    int gradients = 0;
+    int windows = 0;
+    // candidates over the dark weight cut-off, 0 without dark weighting
+    int candidates = 0;
+} LocatorStats;
+
+/*
+ * Buffers find_centers reuses from one call to the next, sized for a square
+ * kFastEyeWidth eye and only grown if a bigger one comes along. Each call
+ * works on views of the size it needs.
+ */
+class EyeWorkspace {
+public:
+    EyeWorkspace();
+
+    // rows x cols view of buffer, reallocated only when it is too small
+    static cv::Mat view(cv::Mat &buffer, int rows, int cols, int type);
+
+    cv::Mat eye_scaled, eye_scaled_gray;
+    cv::Mat transposed, gradient_transposed;
+    cv::Mat gradient_x, gradient_y, magnitude;
+    cv::Mat gradient_x32, gradient_y32, magnitude32;
+    cv::Mat out_sum, out_sum64;
+    cv::Mat eye_coarse, coarse_sum;
+    cv::Mat weight;
+    CandidateSpans spans;
+    GradientList gradients, coarse_gradients;
+    std::vector<std::pair<float, cv::Point> > ranked;
+    std::vector<cv::Point> candidates;
+};
+
+void scale(const cv::Mat &src, cv::Mat &dst, int width = kFastEyeWidth);
+cv::Point unscale_point(cv::Point p, cv::Rect origSize, int width = kFastEyeWidth);
+cv::Mat matrix_magnitude(cv::Mat mat_x, cv::Mat mat_y);
+void matrix_magnitude(const cv::Mat &mat_x, const cv::Mat &mat_y, cv::Mat &mag);
+void possible_centers(int x, int y, const cv::Mat &blurred, double gx, double gy, cv::Mat &output);
+cv::Mat computeMatXGradient(const cv::Mat &mat);
+void computeMatXGradient(const cv::Mat &mat, cv::Mat &out);
+// uses a workspace private to the calling thread
+cv::Point find_centers(cv::Mat face_image, cv::Rect eye_region, LocatorStats *stats = NULL,
+                       PupilFilter *filter = NULL);
+cv::Point find_centers(const cv::Mat &face_image, cv::Rect eye_region, EyeWorkspace &ws, LocatorStats *stats = NULL,
+                       PupilFilter *filter = NULL);
+// eye regions of a face, relative to the face
+void eye_regions(cv::Rect face, cv::Rect &left_eye_region, cv::Rect &right_eye_region);
+void find_eyes(cv::Mat color_image, cv::Rect face, cv::Point &left_pupil_dst, cv::Point &right_pupil_dst,
+               cv::Rect &left_eye_region_dst, cv::Rect &right_eye_region_dst,
+               LocatorStats *left_stats = NULL, LocatorStats *right_stats = NULL, EyeFilters *filters = NULL);
+
+#endif
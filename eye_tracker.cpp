@@ -0,0 +1,138 @@
+#include "eye_tracker.h"
+#include <cstdlib>
+
+using namespace std;
+using namespace cv;
+
+Mat frame_mat(const FrameView &view) {
+    if (!view.data || view.width <= 0 || view.height <= 0) {
+        return Mat();
+    }
+    if (view.format == PIXEL_NV12 && view.height % 2 != 0) {
+        return Mat();
+    }
+    int rows, type;
+    raw_layout(view.format, Size(view.width, view.height), rows, type);
+    size_t row_bytes = (size_t)view.width * CV_ELEM_SIZE(type);
+    size_t stride = view.stride ? view.stride : row_bytes;
+    if (stride < row_bytes) {
+        return Mat();
+    }
+    // the tracker only reads frames, the cast never leads to a write
+    return Mat(rows, view.width, type, const_cast<unsigned char *>(view.data), stride);
+}
+
+void update_eye_offset(EyeSettingsSt &settings, Rect left_eye, Rect right_eye, Point left_pupil, Point right_pupil) {
+    settings.CenterPointOfEyes.x = ((right_eye.x + right_eye.width/2) + (left_eye.x + left_eye.width/2))/2;
+    settings.CenterPointOfEyes.y = ((right_eye.y + right_eye.height/2) + (left_eye.y + left_eye.height/2))/2;
+
+    settings.OffsetFromEyeCenter.x = settings.CenterPointOfEyes.x - (right_pupil.x + left_pupil.x)/2;
+    settings.OffsetFromEyeCenter.y = settings.CenterPointOfEyes.y - (right_pupil.y + left_pupil.y)/2;
+}
+
+void calibrate_edge(EyeSettingsSt &settings, CalibrationEdge edge) {
+    switch (edge) {
+        case CALIBRATE_LEFT:
+            settings.eyeLeftMax = abs(settings.OffsetFromEyeCenter.x);
+            break;
+        case CALIBRATE_RIGHT:
+            settings.eyeRightMax = abs(settings.OffsetFromEyeCenter.x);
+            break;
+        case CALIBRATE_BOTTOM:
+            settings.eyeBottomMax = abs(settings.OffsetFromEyeCenter.y);
+            break;
+        case CALIBRATE_TOP:
+            settings.eyeTopMax = abs(settings.OffsetFromEyeCenter.y);
+            break;
+    }
+}
+
+bool is_calibrated(const EyeSettingsSt &settings) {
+    return settings.eyeLeftMax + settings.eyeRightMax > 0 && settings.eyeTopMax + settings.eyeBottomMax > 0;
+}
+
+Point2d gaze_fraction(const EyeSettingsSt &settings) {
+    double pupilOffsetfromLeft = settings.OffsetFromEyeCenter.x+settings.eyeLeftMax;
+    double pupilOffsetfromBottom = settings.OffsetFromEyeCenter.y+settings.eyeBottomMax;
+
+    double percentageWidth = pupilOffsetfromLeft / (double)(settings.eyeLeftMax + settings.eyeRightMax);
+    if(percentageWidth < 0){
+        percentageWidth = 0;
+    }else if(percentageWidth > 1){
+        percentageWidth = 1;
+    }
+    double percentageHeight = pupilOffsetfromBottom / (double)(settings.eyeTopMax + settings.eyeBottomMax);
+    if(percentageHeight < 0){
+        percentageHeight = 0;
+    }else if(percentageHeight > 1){
+        percentageHeight = 1;
+    }
+    return Point2d(percentageWidth, percentageHeight);
+}
+
+Point gaze_point(const EyeSettingsSt &settings, Size size) {
+    Point2d fraction = gaze_fraction(settings);
+    return Point(size.width * fraction.x, size.height * (1 - fraction.y));
+}
+
+EyeTracker::EyeTracker(CascadeClassifier &face_cascade, MultiFaceLocator *multi_face)
+        : face_tracker(face_cascade), multi_face(multi_face), frames(0) {
+}
+
+void EyeTracker::track(FrameJob &job) {
+    detect(job);
+    locate(job);
+}
+
+void EyeTracker::detect(FrameJob &job) {
+    detect_faces(face_tracker, job);
+}
+
+void EyeTracker::locate(FrameJob &job) {
+    locate_pupils(job, multi_face, &filters);
+}
+
+bool EyeTracker::process(const FrameView &frame, GazeResult &result) {
+    Mat raw = frame_mat(frame);
+    if (raw.empty() || (frame.format != PIXEL_YUYV && frame.format != PIXEL_NV12)) {
+        return process(raw, result);
+    }
+    luma_plane(raw, frame.format, luma);
+    bool processed = process(luma, result);
+    // an NV12 plane is a view of the caller's buffer too
+    if (frame.format == PIXEL_NV12) {
+        luma = Mat();
+    }
+    return processed;
+}
+
+bool EyeTracker::process(const Mat &frame, GazeResult &result) {
+    result = GazeResult();
+    if (frame.empty() || frame.depth() != CV_8U) {
+        return false;
+    }
+    job.frame = frame;
+    job.index = frames++;
+    track(job);
+
+    result.frame = job.index;
+    result.found = job.faces.size() > 0;
+    if (result.found) {
+        result.face = job.faces[0];
+        result.leftEye = job.left_eye;
+        result.rightEye = job.right_eye;
+        result.leftPupil = job.left_pupil;
+        result.rightPupil = job.right_pupil;
+        result.leftStats = job.left_stats;
+        result.rightStats = job.right_stats;
+        update_eye_offset(settings, job.left_eye, job.right_eye, job.left_pupil, job.right_pupil);
+        result.offset = settings.OffsetFromEyeCenter;
+        result.gaze = is_calibrated(settings)
+                      ? gaze_point(settings, screen_size.area() > 0 ? screen_size : frame.size()) : Point(-1, -1);
+    } else {
+        result.gaze = Point(-1, -1);
+    }
+    // drop the view so the caller's buffer isn't referenced past this call
+    job.frame = Mat();
+    return true;
+}
@@ -0,0 +1,125 @@
+#ifndef EYE_TRACKER_H
+#define EYE_TRACKER_H
+
+#include <cstddef>
+#include <opencv2/core/core.hpp>
+#include <opencv2/objdetect/objdetect.hpp>
+#include "eye_center.h"
+#include "face_tracker.h"
+#include "luma.h"
+#include "multi_face.h"
+#include "pipeline.h"
+
+/*
+ * The tracking library: face detection, pupil location and the calibration
+ * that maps pupil offsets to a gaze point, with no window, camera or
+ * keyboard. Eye_Tracking is one client, anything that already has frames
+ * (a renderer, a capture SDK) can embed EyeTracker directly.
+ */
+
+/*
+ * A frame in a buffer the caller owns, read in place and never copied or
+ * written to. It only has to stay valid for the call it is passed to.
+ */
+typedef struct {
+    const unsigned char *data = NULL;
+    int width = 0;
+    int height = 0;
+    // bytes from one row to the next, 0 for tightly packed rows
+    size_t stride = 0;
+    PixelFormat format = PIXEL_BGR;
+} FrameView;
+
+// Mat header over the caller's pixels as raw_layout() lays them out, empty
+// if the view is invalid
+cv::Mat frame_mat(const FrameView &view);
+
+/*
+ * Pupil range of one face, learned by looking at the edges of the screen
+ */
+typedef struct {
+    cv::Point CenterPointOfEyes;
+    cv::Point OffsetFromEyeCenter;
+    int eyeLeftMax=0;//13;
+    int eyeRightMax=0;//13;
+    int eyeTopMax=0;//11;
+    int eyeBottomMax=0;//11;
+    int count = 0;
+} EyeSettingsSt;
+
+enum CalibrationEdge {
+    CALIBRATE_LEFT,
+    CALIBRATE_RIGHT,
+    CALIBRATE_BOTTOM,
+    CALIBRATE_TOP
+};
+
+// eye center and pupil offset from it, regions and pupils relative to the face
+void update_eye_offset(EyeSettingsSt &settings, cv::Rect left_eye, cv::Rect right_eye,
+                       cv::Point left_pupil, cv::Point right_pupil);
+// the current offset becomes the pupil's reach towards edge
+void calibrate_edge(EyeSettingsSt &settings, CalibrationEdge edge);
+// whether both axes have a reach to map across, one edge of each is enough
+bool is_calibrated(const EyeSettingsSt &settings);
+// how far across (from the left) and up (from the bottom) the gaze is, both in [0, 1]
+cv::Point2d gaze_fraction(const EyeSettingsSt &settings);
+// gaze_fraction() on a screen of size, y down
+cv::Point gaze_point(const EyeSettingsSt &settings, cv::Size size);
+
+/*
+ * What one processed frame produced, regions and pupils relative to the face
+ */
+typedef struct {
+    int frame = -1;
+    bool found = false;
+    cv::Rect face;
+    cv::Rect leftEye, rightEye;
+    cv::Point leftPupil, rightPupil;
+    LocatorStats leftStats, rightStats;
+    // pupils from the eye center
+    cv::Point offset;
+    // (-1, -1) until is_calibrated, i.e. an edge of each axis is calibrated
+    cv::Point gaze;
+} GazeResult;
+
+class EyeTracker {
+public:
+    // multi_face: locate every face's pupils with it, the result follows the oldest face
+    explicit EyeTracker(cv::CascadeClassifier &face_cascade, MultiFaceLocator *multi_face = NULL);
+
+    FaceTracker &faceTracker() { return face_tracker; }
+
+    // faces and pupils of job.frame, what one pass of the pipeline does
+    void track(FrameJob &job);
+    void detect(FrameJob &job);
+    void locate(FrameJob &job);
+
+    /*
+     * Tracks one caller owned frame and maps the pupils to a gaze point on
+     * the screen size (the frame size if none was set). YUYV and NV12 frames
+     * are tracked on their luminance alone.
+     * returns false if the frame is invalid
+     */
+    bool process(const FrameView &frame, GazeResult &result);
+    bool process(const cv::Mat &frame, GazeResult &result);
+
+    void setScreenSize(cv::Size size) { screen_size = size; }
+    // the offset of the last processed frame becomes the reach towards edge
+    void calibrate(CalibrationEdge edge) { calibrate_edge(settings, edge); }
+    EyeSettingsSt &calibration() { return settings; }
+
+private:
+    FaceTracker face_tracker;
+    MultiFaceLocator *multi_face;
+    // pupil filters of the single face
+    EyeFilters filters;
+    EyeSettingsSt settings;
+    cv::Size screen_size;
+    // reused by every process(), its frame is a view of the caller's
+    FrameJob job;
+    // Y bytes picked out of a YUYV frame
+    cv::Mat luma;
+    int frames;
+};
+
+#endif
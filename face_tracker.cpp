@@ -0,0 +1,59 @@
+#include "face_tracker.h"
+#include "constants.h"
+
+using namespace std;
+using namespace cv;
+
+FaceTracker::FaceTracker(CascadeClassifier &face_cascade)
+        : face_cascade(face_cascade), tracking(false), all_faces(false), scale_factor(1.1), min_face(0.0),
+          full_detect_every(kTrackFullDetectEvery), last_full(true), frames_since_full(0) {
+}
+
+void FaceTracker::reset() {
+    last_face = Rect();
+    frames_since_full = 0;
+}
+
+void FaceTracker::detect_full(const Mat &gray_image, vector<Rect> &faces) {
+    int flags = 0|CV_HAAR_SCALE_IMAGE|(all_faces ? 0 : CV_HAAR_FIND_BIGGEST_OBJECT);
+    int side = min(gray_image.cols, gray_image.rows) * min_face;
+    face_cascade.detectMultiScale(gray_image, faces, scale_factor, 2, flags, Size(side, side));
+    last_full = true;
+    frames_since_full = 0;
+    search_region = Rect(0, 0, gray_image.cols, gray_image.rows);
+}
+
+void FaceTracker::detect(const Mat &gray_image, vector<Rect> &faces) {
+    if (!tracking || all_faces) {
+        detect_full(gray_image, faces);
+        return;
+    }
+
+    if (last_face.area() > 0 && frames_since_full < full_detect_every) {
+        // search around the previous face, bounded to sizes close to it
+        int margin_x = last_face.width * kTrackSearchMargin;
+        int margin_y = last_face.height * kTrackSearchMargin;
+        search_region = Rect(last_face.x - margin_x, last_face.y - margin_y,
+                             last_face.width + 2 * margin_x, last_face.height + 2 * margin_y)
+                        & Rect(0, 0, gray_image.cols, gray_image.rows);
+        Size min_size(last_face.width * kTrackMinScale, last_face.height * kTrackMinScale);
+        Size max_size(last_face.width * kTrackMaxScale, last_face.height * kTrackMaxScale);
+
+        face_cascade.detectMultiScale(gray_image(search_region), faces, scale_factor, 2,
+                                      0|CV_HAAR_SCALE_IMAGE|CV_HAAR_FIND_BIGGEST_OBJECT, min_size, max_size);
+        last_full = false;
+        frames_since_full++;
+        for (Rect &face : faces) {
+            face.x += search_region.x;
+            face.y += search_region.y;
+        }
+    } else {
+        faces.clear();
+    }
+
+    // lost it (or due for a refresh), look over the whole frame again
+    if (faces.empty()) {
+        detect_full(gray_image, faces);
+    }
+    last_face = faces.empty() ? Rect() : faces[0];
+}
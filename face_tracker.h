@@ -0,0 +1,51 @@
+#ifndef FACE_TRACKER_H
+#define FACE_TRACKER_H
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/objdetect/objdetect.hpp>
+
+/*
+ * Face detection that, once a face is found, only searches an expanded
+ * region around it at sizes close to the last one. A full frame, full scale
+ * range detection still runs every kTrackFullDetectEvery frames and
+ * whenever the face is lost.
+ */
+class FaceTracker {
+public:
+    explicit FaceTracker(cv::CascadeClassifier &face_cascade);
+
+    void setTracking(bool enabled) { tracking = enabled; }
+    bool isTracking() const { return tracking; }
+    // report every face instead of the biggest one, always full frame
+    void setAllFaces(bool enabled) { all_faces = enabled; }
+    // cascade scale step, smallest face as a fraction of the frame's shorter
+    // side, and frames between full frame detections when tracking
+    void setScaleFactor(double factor) { scale_factor = factor; }
+    void setMinFace(double fraction) { min_face = fraction; }
+    void setFullDetectEvery(int frames) { full_detect_every = frames; }
+
+    // detects in gray_image, faces[0] is the tracked face
+    void detect(const cv::Mat &gray_image, std::vector<cv::Rect> &faces);
+    void reset();
+
+    // whether the last detect() searched the whole frame
+    bool lastWasFull() const { return last_full; }
+    cv::Rect searchRegion() const { return search_region; }
+
+private:
+    void detect_full(const cv::Mat &gray_image, std::vector<cv::Rect> &faces);
+
+    cv::CascadeClassifier &face_cascade;
+    bool tracking;
+    bool all_faces;
+    double scale_factor;
+    double min_face;
+    int full_detect_every;
+    bool last_full;
+    int frames_since_full;
+    cv::Rect last_face;
+    cv::Rect search_region;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#include "fixed_locator.h"
+
+using namespace std;
+using namespace cv;
+
+typedef struct {
+    int width, height;
+    FixedLocatorFn locate;
+} FixedLocatorEntry;
+
+#define FIXED_LOCATOR(W, H) {W, H, &FixedLocator<W, H, float>::locate}
+
+/*
+ * kFastEyeWidth is the width find_centers scales to, it has every height a
+ * square face of 100 to 400 px gets (W * 13 / 20 give or take the
+ * truncation of the eye region). The rest are for tuning and only have the
+ * heights more than a few of those faces get.
+ */
+static const FixedLocatorEntry fixed_locators[] = {
+    FIXED_LOCATOR(32, 20),
+    FIXED_LOCATOR(32, 21),
+    FIXED_LOCATOR(50, 30),
+    FIXED_LOCATOR(50, 31),
+    FIXED_LOCATOR(50, 32),
+    FIXED_LOCATOR(50, 33),
+    FIXED_LOCATOR(64, 40),
+    FIXED_LOCATOR(64, 41),
+    FIXED_LOCATOR(64, 42),
+    FIXED_LOCATOR(96, 60),
+    FIXED_LOCATOR(96, 61),
+    FIXED_LOCATOR(96, 62),
+    FIXED_LOCATOR(96, 63),
+};
+
+FixedLocatorFn fixed_locator(int width, int height) {
+    for (const FixedLocatorEntry &entry : fixed_locators) {
+        if (entry.width == width && entry.height == height) {
+            return entry.locate;
+        }
+    }
+    return NULL;
+}
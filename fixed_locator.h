@@ -0,0 +1,149 @@
+#ifndef FIXED_LOCATOR_H
+#define FIXED_LOCATOR_H
+
+#include <cfloat>
+#include <cmath>
+#include <opencv2/core/core.hpp>
+
+/*
+ * The dense locator with the patch size and scalar type fixed at compile
+ * time: gradients, votes and the displacement table live in arrays of
+ * constant size, so the compiler can unroll and vectorize every loop
+ * without runtime bounds or Mat indexing.
+ *
+ * Only the sizes listed in fixed_locator.cpp are built into the binary, so
+ * the hit is partial: find_centers truncates the eye region and then the
+ * scaled rows, which gives a few heights per width. At kFastEyeWidth the
+ * table covers those of square faces 100 to 400 px wide, fixed_locator()
+ * returns NULL for anything else and the caller falls back to the runtime
+ * sized kernels.
+ */
+
+/*
+ * Unit displacement vectors (gradient minus center) for every gradient/center
+ * pair of a W x H grid, indexed [cy - y + H - 1][cx - x + W - 1]
+ */
+template <int W, int H, typename T>
+struct FixedDisplacements {
+    T unit_x[2 * H - 1][2 * W - 1];
+    T unit_y[2 * H - 1][2 * W - 1];
+
+    FixedDisplacements() {
+        for (int r = 0; r < 2 * H - 1; r++) {
+            for (int c = 0; c < 2 * W - 1; c++) {
+                double x = (W - 1) - c, y = (H - 1) - r;
+                double length = sqrt(x * x + y * y);
+                unit_x[r][c] = length > 0.0 ? (T)(x / length) : 0;
+                unit_y[r][c] = length > 0.0 ? (T)(y / length) : 0;
+            }
+        }
+    }
+
+    // built on first use, shared by every thread
+    static const FixedDisplacements &get() {
+        static const FixedDisplacements table;
+        return table;
+    }
+};
+
+template <int W, int H, typename T>
+class FixedLocator {
+public:
+    /*
+     * Finds the pupil on a W x H grey eye patch
+     * returns the position on the patch, voters receives the number of
+     * non-zero gradients that voted
+     */
+    static cv::Point locate(const cv::Mat &eye_gray, int *voters) {
+        CV_Assert(eye_gray.type() == CV_8U && eye_gray.cols == W && eye_gray.rows == H);
+
+        T gradient_x[H][W], gradient_y[H][W], out_sum[H][W];
+        gradients(eye_gray, gradient_x, gradient_y);
+
+        const FixedDisplacements<W, H, T> &table = FixedDisplacements<W, H, T>::get();
+        for (int cy = 0; cy < H; cy++) {
+            for (int cx = 0; cx < W; cx++) {
+                out_sum[cy][cx] = 0;
+            }
+        }
+        int count = 0;
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                T gx = gradient_x[y][x], gy = gradient_y[y][x];
+                if (gx == 0 && gy == 0) {
+                    continue;
+                }
+                count++;
+                for (int cy = 0; cy < H; cy++) {
+                    const T *unit_x = &table.unit_x[cy - y + H - 1][W - 1 - x];
+                    const T *unit_y = &table.unit_y[cy - y + H - 1][W - 1 - x];
+                    T *out = out_sum[cy];
+                    for (int cx = 0; cx < W; cx++) {
+                        T dot = unit_x[cx] * gx + unit_y[cx] * gy;
+                        dot = dot > 0 ? dot : 0;
+                        out[cx] += dot * dot;
+                    }
+                }
+            }
+        }
+        if (voters) {
+            *voters = count;
+        }
+
+        // first maximum in row order, as minMaxLoc
+        cv::Point best(0, 0);
+        T best_value = out_sum[0][0];
+        for (int cy = 0; cy < H; cy++) {
+            for (int cx = 0; cx < W; cx++) {
+                if (out_sum[cy][cx] > best_value) {
+                    best_value = out_sum[cy][cx];
+                    best = cv::Point(cx, cy);
+                }
+            }
+        }
+        return best;
+    }
+
+private:
+    /*
+     * Matlab style gradients scaled to unit L2 norm, as compute_gradients
+     */
+    static void gradients(const cv::Mat &eye_gray, T (&gradient_x)[H][W], T (&gradient_y)[H][W]) {
+        double sum_x = 0.0, sum_y = 0.0;
+        for (int y = 0; y < H; y++) {
+            const unsigned char *row = eye_gray.ptr<unsigned char>(y);
+            const unsigned char *up = eye_gray.ptr<unsigned char>(y > 0 ? y - 1 : 0);
+            const unsigned char *down = eye_gray.ptr<unsigned char>(y < H - 1 ? y + 1 : H - 1);
+            T y_scale = (y == 0 || y == H - 1) ? (T)1 : (T)0.5;
+            gradient_x[y][0] = (T)(row[1] - row[0]);
+            for (int x = 1; x < W - 1; x++) {
+                gradient_x[y][x] = (T)(row[x + 1] - row[x - 1]) * (T)0.5;
+            }
+            gradient_x[y][W - 1] = (T)(row[W - 1] - row[W - 2]);
+            for (int x = 0; x < W; x++) {
+                gradient_y[y][x] = (T)(down[x] - up[x]) * y_scale;
+                sum_x += gradient_x[y][x] * gradient_x[y][x];
+                sum_y += gradient_y[y][x] * gradient_y[y][x];
+            }
+        }
+
+        double norm_x = sqrt(sum_x), norm_y = sqrt(sum_y);
+        T scale_x = norm_x > DBL_EPSILON ? (T)(1.0 / norm_x) : 0;
+        T scale_y = norm_y > DBL_EPSILON ? (T)(1.0 / norm_y) : 0;
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                gradient_x[y][x] *= scale_x;
+                gradient_y[y][x] *= scale_y;
+            }
+        }
+    }
+};
+
+typedef cv::Point (*FixedLocatorFn)(const cv::Mat &eye_gray, int *voters);
+
+/*
+ * Specialization for a width x height grey patch, NULL if none was built
+ */
+FixedLocatorFn fixed_locator(int width, int height);
+
+#endif
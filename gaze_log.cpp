@@ -0,0 +1,173 @@
+#include "gaze_log.h"
+#include "constants.h"
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+GazeLog::GazeLog() : fd(-1), window(NULL), window_offset(0), window_length(0), written(0) {
+}
+
+GazeLog::~GazeLog() {
+    close();
+}
+
+bool GazeLog::open(const string &file_name) {
+    close();
+    fd = ::open(file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    GazeLogHeader header;
+    memcpy(header.magic, kGazeLogMagic, sizeof(header.magic));
+    header.version = kGazeLogVersion;
+    header.sampleSize = sizeof(GazeSample);
+    if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+        close();
+        return false;
+    }
+
+    // windows start page aligned, the header shares the first one
+    window_offset = 0;
+    written = 0;
+    if (!map_window()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Byte offset of sample i from the start of the file
+ */
+static size_t sample_offset(long i) {
+    return sizeof(GazeLogHeader) + (size_t)i * sizeof(GazeSample);
+}
+
+/*
+ * Maps the page aligned window holding the next sample and the
+ * kGazeLogWindowSamples after it, growing the file to cover it
+ */
+bool GazeLog::map_window() {
+    size_t page = sysconf(_SC_PAGESIZE);
+    window_offset = sample_offset(written) / page * page;
+    window_length = page + (size_t)kGazeLogWindowSamples * sizeof(GazeSample);
+    if (ftruncate(fd, window_offset + window_length) != 0) {
+        return false;
+    }
+    void *mapped = mmap(NULL, window_length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, window_offset);
+    if (mapped == MAP_FAILED) {
+        window = NULL;
+        return false;
+    }
+    window = (char *)mapped;
+    return true;
+}
+
+void GazeLog::unmap_window() {
+    if (window) {
+        msync(window, window_length, MS_ASYNC);
+        munmap(window, window_length);
+        window = NULL;
+    }
+}
+
+bool GazeLog::append(const GazeSample &sample) {
+    if (!window) {
+        return false;
+    }
+    if (sample_offset(written + 1) > window_offset + window_length) {
+        // full, hand it to the kernel and move on
+        unmap_window();
+        if (!map_window()) {
+            return false;
+        }
+    }
+    memcpy(window + (sample_offset(written) - window_offset), &sample, sizeof(sample));
+    written++;
+    // batched, asynchronous write back so the kernel never builds up much
+    if (written % kGazeLogFlushSamples == 0) {
+        msync(window, window_length, MS_ASYNC);
+    }
+    return true;
+}
+
+void GazeLog::close() {
+    if (fd < 0) {
+        return;
+    }
+    unmap_window();
+    if (ftruncate(fd, sample_offset(written)) != 0) {
+        perror("gaze log");
+    }
+    ::close(fd);
+    fd = -1;
+}
+
+GazeLogReader::GazeLogReader() : file(NULL), sample_size(0) {
+}
+
+GazeLogReader::~GazeLogReader() {
+    if (file) {
+        fclose(file);
+    }
+}
+
+bool GazeLogReader::open(const string &file_name) {
+    file = fopen(file_name.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    GazeLogHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, kGazeLogMagic, sizeof(header.magic)) != 0 ||
+        header.version != kGazeLogVersion || header.sampleSize < sizeof(GazeSample)) {
+        return false;
+    }
+    sample_size = header.sampleSize;
+    return true;
+}
+
+bool GazeLogReader::next(GazeSample &sample) {
+    if (!file || fread(&sample, sizeof(sample), 1, file) != 1) {
+        return false;
+    }
+    // later minor versions may append fields, skip what this build doesn't know
+    if (sample_size > sizeof(sample)) {
+        fseek(file, sample_size - sizeof(sample), SEEK_CUR);
+    }
+    return true;
+}
+
+string gaze_sample_csv_header() {
+    return "timestamp_ns,frame,face_x,face_y,face_w,face_h,"
+           "left_eye_x,left_eye_y,left_eye_w,left_eye_h,right_eye_x,right_eye_y,right_eye_w,right_eye_h,"
+           "left_x,left_y,right_x,right_y,offset_x,offset_y,gaze_x,gaze_y,target_x,target_y";
+}
+
+static void write_rect(ostream &out, const GazeLogRect &r) {
+    out << "," << r.x << "," << r.y << "," << r.width << "," << r.height;
+}
+
+static void write_point(ostream &out, const GazeLogPoint &p) {
+    out << "," << p.x << "," << p.y;
+}
+
+string gaze_sample_csv(const GazeSample &sample) {
+    stringstream ss;
+    ss << sample.timestamp << "," << sample.frame;
+    write_rect(ss, sample.face);
+    write_rect(ss, sample.leftEye);
+    write_rect(ss, sample.rightEye);
+    write_point(ss, sample.leftPupil);
+    write_point(ss, sample.rightPupil);
+    write_point(ss, sample.offset);
+    write_point(ss, sample.gaze);
+    write_point(ss, sample.target);
+    return ss.str();
+}
@@ -0,0 +1,94 @@
+#ifndef GAZE_LOG_H
+#define GAZE_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Binary per frame gaze log: a GazeLogHeader followed by fixed size
+ * GazeSample records, little endian as written by the tracking machine.
+ * Regions and pupils are in frame coordinates, -1 where there was nothing
+ * to record.
+ */
+const char kGazeLogMagic[8] = {'G', 'A', 'Z', 'E', 'L', 'O', 'G', '\0'};
+const uint32_t kGazeLogVersion = 1;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t sampleSize;
+} GazeLogHeader;
+
+typedef struct {
+    int32_t x, y;
+} GazeLogPoint;
+
+typedef struct {
+    int32_t x, y, width, height;
+} GazeLogRect;
+
+typedef struct {
+    // wall clock, nanoseconds since the epoch
+    int64_t timestamp;
+    int32_t frame;
+    GazeLogRect face, leftEye, rightEye;
+    GazeLogPoint leftPupil, rightPupil;
+    // eye center minus mean pupil, what the calibration maps to the screen
+    GazeLogPoint offset;
+    GazeLogPoint gaze;
+    // shape being looked at while recording, -1 otherwise
+    GazeLogPoint target;
+} GazeSample;
+
+/*
+ * Appends samples to a memory mapped window at the end of the file, so a
+ * frame only pays for a copy. Full windows are handed to the kernel with an
+ * asynchronous msync and the next one is mapped, the file is trimmed to
+ * the samples actually written on close.
+ */
+class GazeLog {
+public:
+    GazeLog();
+    ~GazeLog();
+
+    bool open(const std::string &file_name);
+    bool isOpen() const { return fd >= 0; }
+    bool append(const GazeSample &sample);
+    void close();
+
+    long samples() const { return written; }
+
+private:
+    bool map_window();
+    void unmap_window();
+
+    int fd;
+    char *window;
+    // file offset and length of the mapped window
+    size_t window_offset, window_length;
+    long written;
+};
+
+/*
+ * Reads a log written by GazeLog, sample by sample
+ */
+class GazeLogReader {
+public:
+    GazeLogReader();
+    ~GazeLogReader();
+
+    // false if the file is missing or isn't a gaze log this build can read
+    bool open(const std::string &file_name);
+    bool next(GazeSample &sample);
+
+private:
+    FILE *file;
+    uint32_t sample_size;
+};
+
+// one CSV line per sample, header() names the columns
+std::string gaze_sample_csv_header();
+std::string gaze_sample_csv(const GazeSample &sample);
+
+#endif
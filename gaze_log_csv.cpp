@@ -0,0 +1,30 @@
+#include <iostream>
+#include "gaze_log.h"
+
+using namespace std;
+
+/*
+ * Converts a binary gaze log (Eye_Tracking --log) to CSV on stdout
+ *
+ * Syntax: Eye_Tracking_LogToCsv LOG_FILE
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        cerr << "ERROR: Incorrect number of arguments!\n" <<
+                "Syntax Eye_Tracking_LogToCsv LOG_FILE";
+        exit(1);
+    }
+
+    GazeLogReader reader;
+    if (!reader.open(argv[1])) {
+        cerr << "Failed to open <" << argv[1] << "> as a version " << kGazeLogVersion << " gaze log!";
+        exit(1);
+    }
+
+    cout << gaze_sample_csv_header() << "\n";
+    GazeSample sample;
+    while (reader.next(sample)) {
+        cout << gaze_sample_csv(sample) << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include "gaze_targets.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+using namespace cv;
+
+GazeTargets::GazeTargets() : cell_size(1), cols(0), rows(0) {
+}
+
+void GazeTargets::setTargets(const vector<Point> &targets) {
+    points = targets;
+    build_index();
+}
+
+bool GazeTargets::load(const string &file_name) {
+    ifstream in(file_name.c_str());
+    if (!in) {
+        return false;
+    }
+    vector<Point> targets;
+    string line;
+    while (getline(in, line)) {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == string::npos || line[start] == '#') {
+            continue;
+        }
+        replace(line.begin(), line.end(), ',', ' ');
+        stringstream ss(line);
+        Point p;
+        if (!(ss >> p.x >> p.y)) {
+            return false;
+        }
+        targets.push_back(p);
+    }
+    setTargets(targets);
+    return true;
+}
+
+Point GazeTargets::cell_of(Point p) const {
+    int x = (p.x - origin.x) / cell_size, y = (p.y - origin.y) / cell_size;
+    return Point(min(max(x, 0), cols - 1), min(max(y, 0), rows - 1));
+}
+
+void GazeTargets::build_index() {
+    cell_start.clear();
+    cell_items.clear();
+    cols = rows = 0;
+    if (points.empty()) {
+        return;
+    }
+
+    Point lo(INT_MAX, INT_MAX), hi(INT_MIN, INT_MIN);
+    for (Point p : points) {
+        lo = Point(min(lo.x, p.x), min(lo.y, p.y));
+        hi = Point(max(hi.x, p.x), max(hi.y, p.y));
+    }
+    origin = lo;
+    // about one target per cell over the bounding box
+    double area = (double)(hi.x - lo.x + 1) * (hi.y - lo.y + 1);
+    cell_size = max(1, (int)ceil(sqrt(area / points.size())));
+    cols = (hi.x - lo.x) / cell_size + 1;
+    rows = (hi.y - lo.y) / cell_size + 1;
+
+    // counting sort of the targets into cells
+    cell_start.assign(cols * rows + 1, 0);
+    for (Point p : points) {
+        Point c = cell_of(p);
+        cell_start[c.y * cols + c.x + 1]++;
+    }
+    for (int i = 0; i < cols * rows; i++) {
+        cell_start[i + 1] += cell_start[i];
+    }
+    cell_items.resize(points.size());
+    vector<int> fill(cell_start.begin(), cell_start.end() - 1);
+    for (size_t i = 0; i < points.size(); i++) {
+        Point c = cell_of(points[i]);
+        cell_items[fill[c.y * cols + c.x]++] = i;
+    }
+}
+
+int GazeTargets::nearest(Point p) const {
+    if (points.empty()) {
+        return -1;
+    }
+    Point c = cell_of(p);
+    int best = -1;
+    long best_dist = LONG_MAX;
+    // rings of cells around p's cell, anything beyond ring r is at least
+    // r * cell_size away
+    for (int r = 0; r < max(cols, rows); r++) {
+        for (int y = c.y - r; y <= c.y + r; y++) {
+            if (y < 0 || y >= rows) {
+                continue;
+            }
+            // whole rows on the top and bottom of the ring, the two ends otherwise
+            int step = (y == c.y - r || y == c.y + r) ? 1 : max(1, 2 * r);
+            for (int x = c.x - r; x <= c.x + r; x += step) {
+                if (x < 0 || x >= cols) {
+                    continue;
+                }
+                int cell = y * cols + x;
+                for (int i = cell_start[cell]; i < cell_start[cell + 1]; i++) {
+                    const Point &t = points[cell_items[i]];
+                    long dx = t.x - p.x, dy = t.y - p.y;
+                    long dist = dx * dx + dy * dy;
+                    if (dist < best_dist || (dist == best_dist && cell_items[i] < best)) {
+                        best_dist = dist;
+                        best = cell_items[i];
+                    }
+                }
+            }
+        }
+        long reach = (long)r * cell_size;
+        // strictly closer, a target at exactly reach may still be in the next
+        // ring with a lower index
+        if (best >= 0 && best_dist < reach * reach) {
+            break;
+        }
+    }
+    return best;
+}
+
+void GazeTargets::within(Point p, int radius, vector<int> &hits) const {
+    hits.clear();
+    if (points.empty()) {
+        return;
+    }
+    Point lo = cell_of(Point(p.x - radius, p.y - radius)), hi = cell_of(Point(p.x + radius, p.y + radius));
+    long limit = (long)radius * radius;
+    for (int y = lo.y; y <= hi.y; y++) {
+        for (int x = lo.x; x <= hi.x; x++) {
+            int cell = y * cols + x;
+            for (int i = cell_start[cell]; i < cell_start[cell + 1]; i++) {
+                const Point &t = points[cell_items[i]];
+                long dx = t.x - p.x, dy = t.y - p.y;
+                if (dx * dx + dy * dy <= limit) {
+                    hits.push_back(cell_items[i]);
+                }
+            }
+        }
+    }
+}
+
+DwellTracker::DwellTracker(double select_ms) : select_ms(select_ms), current(-1), since(0.0), selected(false) {
+}
+
+int DwellTracker::update(int target, double now_ms) {
+    if (target != current) {
+        current = target;
+        since = now_ms;
+        selected = false;
+        return -1;
+    }
+    if (current >= 0 && !selected && now_ms - since >= select_ms) {
+        selected = true;
+        return current;
+    }
+    return -1;
+}
@@ -0,0 +1,66 @@
+#ifndef GAZE_TARGETS_H
+#define GAZE_TARGETS_H
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+/*
+ * Targets the gaze can land on, in any layout, with a uniform grid index of
+ * roughly one target per cell so nearest and radius queries only look at
+ * the cells around the query point instead of every target
+ */
+class GazeTargets {
+public:
+    GazeTargets();
+
+    void setTargets(const std::vector<cv::Point> &targets);
+    /*
+     * One target per line as "x,y" or "x y" screen coordinates, blank lines
+     * and lines starting with '#' are skipped
+     * returns false if the file can't be read or a line isn't a point
+     */
+    bool load(const std::string &file_name);
+
+    const std::vector<cv::Point> &targets() const { return points; }
+    size_t size() const { return points.size(); }
+
+    // index of the closest target, -1 when there are none
+    int nearest(cv::Point p) const;
+    // indices of every target within radius of p
+    void within(cv::Point p, int radius, std::vector<int> &hits) const;
+
+private:
+    void build_index();
+    cv::Point cell_of(cv::Point p) const;
+
+    std::vector<cv::Point> points;
+    // targets of cell (x, y) are cell_items[cell_start[i]..cell_start[i + 1]), i = y * cols + x
+    cv::Point origin;
+    int cell_size, cols, rows;
+    std::vector<int> cell_start, cell_items;
+};
+
+/*
+ * How long the gaze has rested on one target, a target is selected once
+ * after dwelling on it for select_ms
+ */
+class DwellTracker {
+public:
+    explicit DwellTracker(double select_ms);
+
+    // target under the gaze this frame (-1 for none), returns a target
+    // selected by this update or -1
+    int update(int target, double now_ms);
+
+    int target() const { return current; }
+    double dwellMs(double now_ms) const { return current >= 0 ? now_ms - since : 0.0; }
+
+private:
+    double select_ms;
+    int current;
+    double since;
+    bool selected;
+};
+
+#endif
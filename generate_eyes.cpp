@@ -0,0 +1,40 @@
+#include <cstdlib>
+#include <iostream>
+#include "synthetic_eye.h"
+
+using namespace std;
+
+/*
+ * Writes a synthetic eye dataset (one PNG per patch and truth.csv) for
+ * Eye_Tracking_Validate --dataset
+ *
+ * Syntax: Eye_Tracking_GenerateEyes [--output DIR] [--samples N] [--seed SEED]
+ */
+int main(int argc, char* argv[]) {
+    string output_dir = "synthetic_eyes";
+    int samples = 4;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && string("--output").compare(argv[i]) == 0) {
+            output_dir = argv[++i];
+        } else if (i + 1 < argc && string("--samples").compare(argv[i]) == 0) {
+            samples = max(1, atoi(argv[++i]));
+        } else if (i + 1 < argc && string("--seed").compare(argv[i]) == 0) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else {
+            cerr << "ERROR: No argument <" << argv[i] << "> exists!\n" <<
+                    "Syntax Eye_Tracking_GenerateEyes [--output DIR] [--samples N] [--seed SEED]";
+            exit(1);
+        }
+    }
+
+    vector<SyntheticEye> eyes;
+    synthetic_eye_dataset(samples, seed, eyes);
+    if (!write_synthetic_eyes(output_dir, eyes)) {
+        cerr << "Failed to write the synthetic eyes to <" << output_dir << ">!";
+        exit(1);
+    }
+    cout << "Wrote " << eyes.size() << " synthetic eyes to " << output_dir << endl;
+    return 0;
+}
@@ -0,0 +1,581 @@
+#include "gradient_voting.h"
+#include "constants.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define VOTE_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace cv;
+
+DisplacementTable::DisplacementTable() : width_(0), height_(0), stride_(0) {
+}
+
+DisplacementTable::DisplacementTable(int width, int height) : width_(0), height_(0), stride_(0) {
+    build(width, height);
+}
+
+void DisplacementTable::build(int width, int height) {
+    width_ = width;
+    height_ = height;
+    // pad rows so a full candidate row can always be loaded from any gradient column
+    stride_ = ((2 * width - 1) + 7) & ~7;
+    unit_x.assign((size_t)stride_ * (2 * height - 1), 0.0f);
+    unit_y.assign((size_t)stride_ * (2 * height - 1), 0.0f);
+
+    for (int r = 0; r < 2 * height - 1; r++) {
+        // candidate minus gradient offsets, displacement is the negation
+        double dy = -(r - (height - 1));
+        for (int c = 0; c < 2 * width - 1; c++) {
+            double dx = -(c - (width - 1));
+            if (dx == 0.0 && dy == 0.0) {
+                // gradient on the candidate itself never votes
+                continue;
+            }
+            double magnitude = sqrt((dx * dx) + (dy * dy));
+            unit_x[(size_t)r * stride_ + c] = (float)(dx / magnitude);
+            unit_y[(size_t)r * stride_ + c] = (float)(dy / magnitude);
+        }
+    }
+}
+
+const DisplacementTable &displacement_table(int width, int height) {
+    static const DisplacementTable fast_table(kFastEyeWidth, kFastEyeWidth);
+    if (fast_table.fits(width, height)) {
+        return fast_table;
+    }
+
+    static thread_local DisplacementTable scratch_table;
+    if (!scratch_table.fits(width, height)) {
+        scratch_table.build(width, height);
+    }
+    return scratch_table;
+}
+
+static void vote_row_scalar(const float *unit_x, const float *unit_y, float gx, float gy, float *out, int n) {
+    for (int i = 0; i < n; i++) {
+        float dotProduct = unit_x[i] * gx + unit_y[i] * gy;
+        if (dotProduct > 0.0f) {
+            out[i] += dotProduct * dotProduct;
+        }
+    }
+}
+
+#if VOTE_X86
+__attribute__((target("sse2")))
+static void vote_row_sse(const float *unit_x, const float *unit_y, float gx, float gy, float *out, int n) {
+    const __m128 vgx = _mm_set1_ps(gx), vgy = _mm_set1_ps(gy), zero = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 dot = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(unit_x + i), vgx),
+                                _mm_mul_ps(_mm_loadu_ps(unit_y + i), vgy));
+        dot = _mm_max_ps(dot, zero);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(dot, dot)));
+    }
+    vote_row_scalar(unit_x + i, unit_y + i, gx, gy, out + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+static void vote_row_avx2(const float *unit_x, const float *unit_y, float gx, float gy, float *out, int n) {
+    const __m256 vgx = _mm256_set1_ps(gx), vgy = _mm256_set1_ps(gy), zero = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 dot = _mm256_fmadd_ps(_mm256_loadu_ps(unit_x + i), vgx,
+                                     _mm256_mul_ps(_mm256_loadu_ps(unit_y + i), vgy));
+        dot = _mm256_max_ps(dot, zero);
+        _mm256_storeu_ps(out + i, _mm256_fmadd_ps(dot, dot, _mm256_loadu_ps(out + i)));
+    }
+    vote_row_sse(unit_x + i, unit_y + i, gx, gy, out + i, n - i);
+}
+#endif
+
+VoteEngine resolve_vote_engine(VoteEngine requested) {
+#if VOTE_X86
+    static const bool has_sse = __builtin_cpu_supports("sse2");
+    static const bool has_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    const bool has_sse = false;
+    const bool has_avx2 = false;
+#endif
+    switch (requested) {
+        case VOTE_AUTO:
+            return has_avx2 ? VOTE_AVX2 : (has_sse ? VOTE_SSE : VOTE_SCALAR);
+        case VOTE_AVX2:
+            if (has_avx2) {
+                return VOTE_AVX2;
+            }
+            // fall through to the next narrower kernel
+        case VOTE_SSE:
+            return has_sse ? VOTE_SSE : VOTE_SCALAR;
+        default:
+            return requested;
+    }
+}
+
+VoteRowFn vote_row_kernel(VoteEngine engine) {
+    switch (resolve_vote_engine(engine)) {
+#if VOTE_X86
+        case VOTE_AVX2:
+            return vote_row_avx2;
+        case VOTE_SSE:
+            return vote_row_sse;
+#endif
+        default:
+            return vote_row_scalar;
+    }
+}
+
+const char *vote_engine_name(VoteEngine engine) {
+    switch (engine) {
+        case VOTE_REFERENCE: return "reference";
+        case VOTE_AUTO: return "auto";
+        case VOTE_SCALAR: return "scalar";
+        case VOTE_SSE: return "sse";
+        case VOTE_AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+bool parse_vote_engine(const string &name, VoteEngine &engine) {
+    const VoteEngine engines[] = {VOTE_REFERENCE, VOTE_AUTO, VOTE_SCALAR, VOTE_SSE, VOTE_AVX2};
+    for (VoteEngine e : engines) {
+        if (name == vote_engine_name(e)) {
+            engine = e;
+            return true;
+        }
+    }
+    return false;
+}
+
+double dynamic_threshold(const Mat &magnitude, double std_dev_factor) {
+    Scalar mean_magnitude, std_magnitude;
+    meanStdDev(magnitude, mean_magnitude, std_magnitude);
+    double std_dev = std_magnitude[0] / sqrt((double)(magnitude.rows * magnitude.cols));
+    return std_dev_factor * std_dev + mean_magnitude[0];
+}
+
+template <typename T>
+static void collect_gradients(const Mat &gradient_x, const Mat &gradient_y, const Mat &magnitude,
+                              double threshold, GradientList &gradients) {
+    for (int y = 0; y < gradient_x.rows; y++) {
+        const T *x_row = gradient_x.ptr<T>(y), *y_row = gradient_y.ptr<T>(y);
+        const T *mag_row = magnitude.empty() ? NULL : magnitude.ptr<T>(y);
+        for (int x = 0; x < gradient_x.cols; x++) {
+            if ((mag_row && mag_row[x] <= threshold) || (x_row[x] == 0 && y_row[x] == 0)) {
+                continue;
+            }
+            GradientEntry entry = {x, y, (float)x_row[x], (float)y_row[x]};
+            gradients.push_back(entry);
+        }
+    }
+}
+
+void build_gradient_list(const Mat &gradient_x, const Mat &gradient_y, const Mat &magnitude,
+                         double threshold, GradientList &gradients) {
+    CV_Assert(gradient_x.type() == gradient_y.type() && (gradient_x.type() == CV_64F || gradient_x.type() == CV_32F));
+    CV_Assert(magnitude.empty() || magnitude.type() == gradient_x.type());
+
+    gradients.clear();
+    if (gradient_x.type() == CV_64F) {
+        collect_gradients<double>(gradient_x, gradient_y, magnitude, threshold, gradients);
+    } else {
+        collect_gradients<float>(gradient_x, gradient_y, magnitude, threshold, gradients);
+    }
+}
+
+#if VOTE_X86
+/*
+ * (a - b) * scale for 8 pixels, as two float vectors
+ */
+static inline void difference8(const unsigned char *a, const unsigned char *b, __m128 scale, __m128 &lo, __m128 &hi) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i va = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)a), zero);
+    __m128i vb = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)b), zero);
+    __m128i d = _mm_sub_epi16(va, vb);
+    // sign extend the 16-bit differences
+    lo = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(d, d), 16)), scale);
+    hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(d, d), 16)), scale);
+}
+#endif
+
+void fused_gradients(const unsigned char *src, int src_step, int rows, int cols,
+                     float *gradient_x, int x_step, float *gradient_y, int y_step,
+                     float *magnitude, int magnitude_step) {
+    double sum_x = 0.0, sum_y = 0.0;
+
+    for (int y = 0; y < rows; y++) {
+        const unsigned char *row = src + (size_t)y * src_step;
+        // one sided at the top and bottom, central in between
+        const unsigned char *up = src + (size_t)max(y - 1, 0) * src_step;
+        const unsigned char *down = src + (size_t)min(y + 1, rows - 1) * src_step;
+        float y_scale = (y == 0 || y == rows - 1) ? 1.0f : 0.5f;
+        float *gx = gradient_x + (size_t)y * x_step;
+        float *gy = gradient_y + (size_t)y * y_step;
+        float *mag = magnitude ? magnitude + (size_t)y * magnitude_step : NULL;
+
+        gx[0] = row[1] - row[0];
+        gx[cols - 1] = row[cols - 1] - row[cols - 2];
+
+        int x = 0;
+#if VOTE_X86
+        const __m128 half = _mm_set1_ps(0.5f), vy_scale = _mm_set1_ps(y_scale);
+        __m128 row_sum_x = _mm_setzero_ps(), row_sum_y = _mm_setzero_ps();
+        // interior x gradients start at 1, y gradients at 0, share the loads
+        for (x = 1; x + 8 <= cols - 1; x += 8) {
+            __m128 gx_lo, gx_hi, gy_lo, gy_hi;
+            difference8(row + x + 1, row + x - 1, half, gx_lo, gx_hi);
+            difference8(down + x, up + x, vy_scale, gy_lo, gy_hi);
+            _mm_storeu_ps(gx + x, gx_lo);
+            _mm_storeu_ps(gx + x + 4, gx_hi);
+            _mm_storeu_ps(gy + x, gy_lo);
+            _mm_storeu_ps(gy + x + 4, gy_hi);
+            if (mag) {
+                _mm_storeu_ps(mag + x, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(gx_lo, gx_lo), _mm_mul_ps(gy_lo, gy_lo))));
+                _mm_storeu_ps(mag + x + 4, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(gx_hi, gx_hi), _mm_mul_ps(gy_hi, gy_hi))));
+            }
+            row_sum_x = _mm_add_ps(row_sum_x, _mm_add_ps(_mm_mul_ps(gx_lo, gx_lo), _mm_mul_ps(gx_hi, gx_hi)));
+            row_sum_y = _mm_add_ps(row_sum_y, _mm_add_ps(_mm_mul_ps(gy_lo, gy_lo), _mm_mul_ps(gy_hi, gy_hi)));
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, row_sum_x);
+        sum_x += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        _mm_storeu_ps(lanes, row_sum_y);
+        sum_y += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#else
+        x = 1;
+#endif
+        for (; x < cols - 1; x++) {
+            gx[x] = (row[x + 1] - row[x - 1]) * 0.5f;
+            gy[x] = (down[x] - up[x]) * y_scale;
+            if (mag) {
+                mag[x] = sqrt(gx[x] * gx[x] + gy[x] * gy[x]);
+            }
+            sum_x += gx[x] * gx[x];
+            sum_y += gy[x] * gy[x];
+        }
+
+        // first and last columns
+        const int edges[2] = {0, cols - 1};
+        for (int e = 0; e < 2; e++) {
+            int c = edges[e];
+            gy[c] = (down[c] - up[c]) * y_scale;
+            if (mag) {
+                mag[c] = sqrt(gx[c] * gx[c] + gy[c] * gy[c]);
+            }
+            sum_x += gx[c] * gx[c];
+            sum_y += gy[c] * gy[c];
+        }
+    }
+
+    // unit L2 norm, an all zero gradient stays zero as with normalize()
+    double norm_x = sqrt(sum_x), norm_y = sqrt(sum_y);
+    float scale_x = norm_x > DBL_EPSILON ? (float)(1.0 / norm_x) : 0.0f;
+    float scale_y = norm_y > DBL_EPSILON ? (float)(1.0 / norm_y) : 0.0f;
+    for (int y = 0; y < rows; y++) {
+        float *gx = gradient_x + (size_t)y * x_step;
+        float *gy = gradient_y + (size_t)y * y_step;
+        for (int x = 0; x < cols; x++) {
+            gx[x] *= scale_x;
+            gy[x] *= scale_y;
+        }
+    }
+}
+
+void compute_gradients(const Mat &gray, Mat &gradient_x, Mat &gradient_y, Mat *magnitude) {
+    CV_Assert(gray.type() == CV_8U && gray.cols >= 2 && gray.rows >= 2);
+
+    gradient_x.create(gray.rows, gray.cols, CV_32F);
+    gradient_y.create(gray.rows, gray.cols, CV_32F);
+    if (magnitude) {
+        magnitude->create(gray.rows, gray.cols, CV_32F);
+    }
+
+    fused_gradients(gray.ptr<unsigned char>(0), (int)gray.step, gray.rows, gray.cols,
+                    gradient_x.ptr<float>(0), (int)(gradient_x.step / sizeof(float)),
+                    gradient_y.ptr<float>(0), (int)(gradient_y.step / sizeof(float)),
+                    magnitude ? magnitude->ptr<float>(0) : NULL,
+                    magnitude ? (int)(magnitude->step / sizeof(float)) : 0);
+}
+
+// index into 0..n-1 mirrored about the ends without repeating them, as BORDER_REFLECT_101
+static inline int reflect101(int i, int n) {
+    if (n == 1) {
+        return 0;
+    }
+    while (i < 0 || i >= n) {
+        i = i < 0 ? -i : 2 * n - 2 - i;
+    }
+    return i;
+}
+
+/*
+ * 1 4 6 4 1 taps, the 5x5 Gaussian for sigma 0. Sums stay below 16 * 16 *
+ * 255 = 65280, so 16 bits hold them without wrapping.
+ */
+static inline unsigned taps(unsigned a, unsigned b, unsigned c, unsigned d, unsigned e) {
+    return a + e + 4 * (b + d) + 6 * c;
+}
+
+// inverted, contrast stretched and rounded like saturate_cast<uchar>
+static inline float contrast(unsigned sum) {
+    float inverted = 255.0f - (float)((sum + 128) >> 8);
+    return min(255.0f, max(0.0f, (float)cvRound(1.01f * inverted - 10.0f)));
+}
+
+void dark_weight(const Mat &gray, Mat &weight) {
+    CV_Assert(gray.type() == CV_8U);
+    weight.create(gray.rows, gray.cols, CV_32F);
+    const int rows = gray.rows, cols = gray.cols;
+
+    // one row of vertical sums, with two reflected columns either side
+    static thread_local vector<unsigned short> column_buffer;
+    if (column_buffer.size() < (size_t)cols + 4) {
+        column_buffer.resize(cols + 4);
+    }
+    unsigned short *sums = &column_buffer[2];
+
+    for (int y = 0; y < rows; y++) {
+        const unsigned char *r0 = gray.ptr<unsigned char>(reflect101(y - 2, rows));
+        const unsigned char *r1 = gray.ptr<unsigned char>(reflect101(y - 1, rows));
+        const unsigned char *r2 = gray.ptr<unsigned char>(y);
+        const unsigned char *r3 = gray.ptr<unsigned char>(reflect101(y + 1, rows));
+        const unsigned char *r4 = gray.ptr<unsigned char>(reflect101(y + 2, rows));
+
+        int x = 0;
+#if VOTE_X86
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 8 <= cols; x += 8) {
+            __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(r0 + x)), zero);
+            __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(r1 + x)), zero);
+            __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(r2 + x)), zero);
+            __m128i d = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(r3 + x)), zero);
+            __m128i e = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(r4 + x)), zero);
+            __m128i sum = _mm_add_epi16(_mm_add_epi16(a, e), _mm_slli_epi16(_mm_add_epi16(b, d), 2));
+            sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_slli_epi16(c, 2), _mm_slli_epi16(c, 1)));
+            _mm_storeu_si128((__m128i *)(sums + x), sum);
+        }
+#endif
+        for (; x < cols; x++) {
+            sums[x] = taps(r0[x], r1[x], r2[x], r3[x], r4[x]);
+        }
+        sums[-1] = sums[reflect101(-1, cols)];
+        sums[-2] = sums[reflect101(-2, cols)];
+        sums[cols] = sums[reflect101(cols, cols)];
+        sums[cols + 1] = sums[reflect101(cols + 1, cols)];
+
+        float *out = weight.ptr<float>(y);
+        x = 0;
+#if VOTE_X86
+        const __m128i round = _mm_set1_epi16(128), white = _mm_set1_epi16(255);
+        const __m128 gain = _mm_set1_ps(1.01f), offset = _mm_set1_ps(10.0f);
+        for (; x + 8 <= cols; x += 8) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(sums + x - 2));
+            __m128i b = _mm_loadu_si128((const __m128i *)(sums + x - 1));
+            __m128i c = _mm_loadu_si128((const __m128i *)(sums + x));
+            __m128i d = _mm_loadu_si128((const __m128i *)(sums + x + 1));
+            __m128i e = _mm_loadu_si128((const __m128i *)(sums + x + 2));
+            __m128i sum = _mm_add_epi16(_mm_add_epi16(a, e), _mm_slli_epi16(_mm_add_epi16(b, d), 2));
+            sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_slli_epi16(c, 2), _mm_slli_epi16(c, 1)));
+            __m128i inverted = _mm_sub_epi16(white, _mm_srli_epi16(_mm_add_epi16(sum, round), 8));
+            // 1.01 w - 10 rounded to nearest even like cvRound, then saturated to 0..255
+            __m128 lo = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(inverted, zero)), gain), offset);
+            __m128 hi = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(inverted, zero)), gain), offset);
+            __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+            packed = _mm_min_epi16(_mm_max_epi16(packed, zero), white);
+            _mm_storeu_ps(out + x, _mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, zero)));
+            _mm_storeu_ps(out + x + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(packed, zero)));
+        }
+#endif
+        for (; x < cols; x++) {
+            out[x] = contrast(taps(sums[x - 2], sums[x - 1], sums[x], sums[x + 1], sums[x + 2]));
+        }
+    }
+}
+
+int candidate_spans(const Mat &weight, float cut_off, CandidateSpans &spans) {
+    CV_Assert(weight.type() == CV_32F);
+    spans.resize(weight.rows);
+    int covered = 0;
+    for (int y = 0; y < weight.rows; y++) {
+        const float *row = weight.ptr<float>(y);
+        int first = 0, last = weight.cols;
+        while (first < last && row[first] < cut_off) {
+            first++;
+        }
+        while (last > first && row[last - 1] < cut_off) {
+            last--;
+        }
+        spans[y] = make_pair(first, last);
+        covered += last - first;
+    }
+    return covered;
+}
+
+template <typename T>
+static void apply_weight_rows(Mat &out_sum, const Mat &weight, float cut_off) {
+    for (int y = 0; y < out_sum.rows; y++) {
+        T *out = out_sum.ptr<T>(y);
+        const float *w = weight.ptr<float>(y);
+        for (int x = 0; x < out_sum.cols; x++) {
+            out[x] = w[x] >= cut_off ? out[x] * w[x] : 0;
+        }
+    }
+}
+
+void apply_weight(Mat &out_sum, const Mat &weight, float cut_off) {
+    CV_Assert((out_sum.type() == CV_32F || out_sum.type() == CV_64F) && weight.type() == CV_32F &&
+              out_sum.size() == weight.size());
+    if (out_sum.type() == CV_64F) {
+        apply_weight_rows<double>(out_sum, weight, cut_off);
+    } else {
+        apply_weight_rows<float>(out_sum, weight, cut_off);
+    }
+}
+
+/*
+ * Adds one gradient's votes to every candidate row of window
+ */
+static inline void vote_gradient(const DisplacementTable &table, VoteRowFn vote_row, int x, int y,
+                                 float gx, float gy, Mat &out_sum, const Rect &window, const CandidateSpans *spans) {
+    for (int cy = window.y; cy < window.y + window.height; cy++) {
+        int first = window.x, last = window.x + window.width;
+        if (spans) {
+            first = max(first, (*spans)[cy].first);
+            last = min(last, (*spans)[cy].second);
+            if (first >= last) {
+                continue;
+            }
+        }
+        vote_row(table.row_x(x, y, cy) + first, table.row_y(x, y, cy) + first, gx, gy,
+                 out_sum.ptr<float>(cy) + first, last - first);
+    }
+}
+
+int accumulate_votes(const Mat &gradient_x, const Mat &gradient_y, Mat &out_sum, VoteEngine engine, const Rect &window,
+                     const CandidateSpans *spans) {
+    CV_Assert(gradient_x.type() == CV_32F && gradient_y.type() == CV_32F && out_sum.type() == CV_32F);
+
+    const DisplacementTable &table = displacement_table(out_sum.cols, out_sum.rows);
+    VoteRowFn vote_row = vote_row_kernel(engine);
+    Rect candidates = window.area() > 0 ? window : Rect(0, 0, out_sum.cols, out_sum.rows);
+
+    int voters = 0;
+    for (int y = 0; y < gradient_x.rows; y++) {
+        const float *x_row = gradient_x.ptr<float>(y), *y_row = gradient_y.ptr<float>(y);
+        for (int x = 0; x < gradient_x.cols; x++) {
+            float gx = x_row[x], gy = y_row[x];
+            if (gx == 0.0f && gy == 0.0f) {
+                continue;
+            }
+            vote_gradient(table, vote_row, x, y, gx, gy, out_sum, candidates, spans);
+            voters++;
+        }
+    }
+    return voters;
+}
+
+void accumulate_votes(const GradientList &gradients, Mat &out_sum, VoteEngine engine, const Rect &window,
+                      const CandidateSpans *spans) {
+    CV_Assert(out_sum.type() == CV_32F);
+
+    const DisplacementTable &table = displacement_table(out_sum.cols, out_sum.rows);
+    VoteRowFn vote_row = vote_row_kernel(engine);
+    Rect candidates = window.area() > 0 ? window : Rect(0, 0, out_sum.cols, out_sum.rows);
+
+    for (const GradientEntry &g : gradients) {
+        vote_gradient(table, vote_row, g.x, g.y, g.gx, g.gy, out_sum, candidates, spans);
+    }
+}
+
+/*
+ * Kernel spectra for one grid size, and the planes the gradients are padded
+ * into, kept per thread so warm calls only run the transforms
+ */
+class FftObjective {
+public:
+    FftObjective() : width(0), height(0) {}
+
+    void build(int w, int h) {
+        width = w;
+        height = h;
+        // linear convolution over the w x h outputs needs 2w - 1 x 2h - 1
+        Size padded(getOptimalDFTSize(2 * w - 1), getOptimalDFTSize(2 * h - 1));
+
+        Mat kernels[3];
+        for (int k = 0; k < 3; k++) {
+            kernels[k] = Mat::zeros(padded, CV_32F);
+        }
+        // displacement (dx, dy) is stored at (dx mod width, dy mod height)
+        for (int dy = -(h - 1); dy <= h - 1; dy++) {
+            for (int dx = -(w - 1); dx <= w - 1; dx++) {
+                double length_sq = (double)dx * dx + (double)dy * dy;
+                if (length_sq == 0.0) {
+                    continue;
+                }
+                int r = (dy + padded.height) % padded.height, c = (dx + padded.width) % padded.width;
+                kernels[0].at<float>(r, c) = (float)(dx * dx / length_sq);
+                kernels[1].at<float>(r, c) = (float)(2.0 * dx * dy / length_sq);
+                kernels[2].at<float>(r, c) = (float)(dy * dy / length_sq);
+            }
+        }
+        for (int k = 0; k < 3; k++) {
+            dft(kernels[k], kernel_spectra[k]);
+            planes[k] = Mat::zeros(padded, CV_32F);
+        }
+    }
+
+    void evaluate(const Mat &gradient_x, const Mat &gradient_y, Mat &out_sum) {
+        if (width != gradient_x.cols || height != gradient_x.rows) {
+            build(gradient_x.cols, gradient_x.rows);
+        }
+        Rect grid(0, 0, width, height);
+        Mat xx = planes[0](grid), xy = planes[1](grid), yy = planes[2](grid);
+        multiply(gradient_x, gradient_x, xx);
+        multiply(gradient_x, gradient_y, xy);
+        multiply(gradient_y, gradient_y, yy);
+
+        for (int k = 0; k < 3; k++) {
+            dft(planes[k], spectrum);
+            mulSpectrums(spectrum, kernel_spectra[k], product, 0, true);
+            if (k == 0) {
+                product.copyTo(total);
+            } else {
+                add(total, product, total);
+            }
+        }
+        // score(c) = sum over p of G(p) K(p - c), a correlation
+        dft(total, result, DFT_INVERSE | DFT_SCALE | DFT_REAL_OUTPUT);
+        result(grid).copyTo(out_sum);
+    }
+
+private:
+    int width, height;
+    Mat kernel_spectra[3];
+    Mat planes[3];
+    Mat spectrum, product, total, result;
+};
+
+void fft_objective(const Mat &gradient_x, const Mat &gradient_y, Mat &out_sum) {
+    CV_Assert(gradient_x.type() == CV_32F && gradient_y.type() == CV_32F);
+    static thread_local FftObjective objective;
+    objective.evaluate(gradient_x, gradient_y, out_sum);
+}
+
+double score_center(const GradientList &gradients, Point center) {
+    double sum = 0.0;
+    for (const GradientEntry &g : gradients) {
+        double dx = g.x - center.x, dy = g.y - center.y;
+        if (dx == 0.0 && dy == 0.0) {
+            continue;
+        }
+        double dot = (dx * g.gx + dy * g.gy) / sqrt(dx * dx + dy * dy);
+        if (dot > 0.0) {
+            sum += dot * dot;
+        }
+    }
+    return sum;
+}
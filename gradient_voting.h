@@ -0,0 +1,174 @@
+#ifndef GRADIENT_VOTING_H
+#define GRADIENT_VOTING_H
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+/*
+ * Kernels available for accumulating gradient votes into outSum.
+ * VOTE_REFERENCE is the original double precision possible_centers() loop,
+ * VOTE_AUTO picks the widest SIMD kernel the running CPU supports, or a
+ * compile-time specialization (fixed_locator.h) when one fits the patch.
+ */
+enum VoteEngine {
+    VOTE_REFERENCE,
+    VOTE_AUTO,
+    VOTE_SCALAR,
+    VOTE_SSE,
+    VOTE_AVX2
+};
+
+/*
+ * Precomputed unit displacement vectors d = (x - cx, y - cy) / |d| for every
+ * gradient/center pair of a width x height grid (equation (2) in the paper).
+ * Rows are laid out so that for a fixed gradient and candidate row the
+ * vectors for cx = 0..width-1 are contiguous.
+ */
+class DisplacementTable {
+public:
+    DisplacementTable();
+    DisplacementTable(int width, int height);
+
+    void build(int width, int height);
+    bool fits(int width, int height) const { return width <= width_ && height <= height_; }
+
+    // unit vectors for gradient (x, y) against candidates (0..width-1, cy)
+    const float *row_x(int x, int y, int cy) const { return &unit_x[offset(x, y, cy)]; }
+    const float *row_y(int x, int y, int cy) const { return &unit_y[offset(x, y, cy)]; }
+
+private:
+    size_t offset(int x, int y, int cy) const {
+        return (size_t)(cy - y + height_ - 1) * stride_ + (width_ - 1 - x);
+    }
+
+    int width_, height_, stride_;
+    std::vector<float> unit_x, unit_y;
+};
+
+/*
+ * Adds max(0, d.g)^2 for one gradient to n contiguous candidates
+ */
+typedef void (*VoteRowFn)(const float *unit_x, const float *unit_y, float gx, float gy, float *out, int n);
+
+VoteEngine resolve_vote_engine(VoteEngine requested);
+VoteRowFn vote_row_kernel(VoteEngine engine);
+const char *vote_engine_name(VoteEngine engine);
+bool parse_vote_engine(const std::string &name, VoteEngine &engine);
+
+/*
+ * Returns a table covering a width x height grid, the kFastEyeWidth table is
+ * shared, anything larger is built per thread on demand
+ */
+const DisplacementTable &displacement_table(int width, int height);
+
+/*
+ * A gradient kept for voting, with its position on the scaled eye grid
+ */
+typedef struct {
+    int x, y;
+    float gx, gy;
+} GradientEntry;
+typedef std::vector<GradientEntry> GradientList;
+
+/*
+ * Magnitude cut-off of mean + factor * stddev / sqrt(pixels), so the
+ * threshold follows the contrast of each patch instead of a fixed value
+ */
+double dynamic_threshold(const cv::Mat &magnitude, double std_dev_factor);
+
+/*
+ * Matlab style x and y gradients (central differences, one sided on the
+ * border rows and columns, as computeMatXGradient) of an 8-bit image in a
+ * single row pass, each scaled to unit L2 norm like normalize()
+ *
+ * gradient_x, gradient_y: CV_32F outputs the size of gray
+ * magnitude: optional CV_32F output, magnitude before normalization
+ */
+void compute_gradients(const cv::Mat &gray, cv::Mat &gradient_x, cv::Mat &gradient_y, cv::Mat *magnitude = NULL);
+
+// raw pointer core of compute_gradients, steps are in elements
+void fused_gradients(const unsigned char *src, int src_step, int rows, int cols,
+                     float *gradient_x, int x_step, float *gradient_y, int y_step,
+                     float *magnitude, int magnitude_step);
+
+/*
+ * Collects the gradients whose magnitude is above threshold
+ *
+ * gradient_x, gradient_y: CV_64F or CV_32F gradients, copied into the list
+ * magnitude: magnitude of the same depth used for thresholding, empty keeps
+ *            every non-zero gradient
+ */
+void build_gradient_list(const cv::Mat &gradient_x, const cv::Mat &gradient_y, const cv::Mat &magnitude,
+                         double threshold, GradientList &gradients);
+
+/*
+ * Columns [first, second) of each candidate row worth scoring, an empty
+ * span skips the row
+ */
+typedef std::vector<std::pair<int, int> > CandidateSpans;
+
+/*
+ * The paper's center weight (section 2.1): the eye smoothed with a 5x5
+ * Gaussian, inverted and given a little more contrast (1.01 w - 10), so dark
+ * pupil pixels weigh most. Blur, inversion and contrast are one pass over
+ * the image with 16-bit integer sums, matching GaussianBlur's rounding.
+ *
+ * gray: CV_8U scaled eye
+ * weight: CV_32F output the size of gray, 0..255
+ */
+void dark_weight(const cv::Mat &gray, cv::Mat &weight);
+
+/*
+ * Spans of the candidates weighing at least cut_off, from the first to the
+ * last such candidate of each row
+ * returns the number of candidates the spans cover
+ */
+int candidate_spans(const cv::Mat &weight, float cut_off, CandidateSpans &spans);
+
+/*
+ * Scales each candidate's votes by its weight, those under cut_off score 0
+ *
+ * out_sum: CV_32F or CV_64F votes, weight: CV_32F of the same size
+ */
+void apply_weight(cv::Mat &out_sum, const cv::Mat &weight, float cut_off);
+
+/*
+ * Casts the votes of every non-zero gradient
+ *
+ * gradient_x, gradient_y: CV_32F gradients of the scaled eye
+ * out_sum: CV_32F accumulator of the same size, added to in place
+ * window: candidates to score, empty scores the whole grid
+ * spans: optional, only candidates within them (and window) are scored
+ * returns the number of gradients that voted
+ */
+int accumulate_votes(const cv::Mat &gradient_x, const cv::Mat &gradient_y, cv::Mat &out_sum, VoteEngine engine,
+                     const cv::Rect &window = cv::Rect(), const CandidateSpans *spans = NULL);
+
+/*
+ * Casts the votes of a sparse gradient list
+ *
+ * window: candidates to score, empty scores the whole grid
+ * spans: optional, only candidates within them (and window) are scored
+ */
+void accumulate_votes(const GradientList &gradients, cv::Mat &out_sum, VoteEngine engine,
+                      const cv::Rect &window = cv::Rect(), const CandidateSpans *spans = NULL);
+
+/*
+ * Approximate objective without the max(0, d.g) clamp, which expands to
+ * gx^2 * dx^2 + 2 gx gy * dx dy + gy^2 * dy^2 over unit displacements and so
+ * is three convolutions with fixed kernels, evaluated by FFT in
+ * O(N log N) instead of O(N^2). Opposite facing gradients vote as well, so
+ * the peak is only a candidate for score_center() to confirm.
+ *
+ * gradient_x, gradient_y: CV_32F normalized gradients
+ * out_sum: CV_32F output of the same size, overwritten
+ */
+void fft_objective(const cv::Mat &gradient_x, const cv::Mat &gradient_y, cv::Mat &out_sum);
+
+/*
+ * Exact, clamped objective of a single center
+ */
+double score_center(const GradientList &gradients, cv::Point center);
+
+#endif
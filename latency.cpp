@@ -0,0 +1,150 @@
+#include "latency.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+static atomic<bool> enabled(false);
+static LatencyHistogram histograms[LATENCY_STAGE_COUNT];
+
+static const char *stage_names[LATENCY_STAGE_COUNT] = {
+    "capture", "gray", "detect", "find_centers", "gaze", "render", "frame"
+};
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    for (int i = 0; i < kBuckets; i++) {
+        counts[i].store(0, memory_order_relaxed);
+    }
+    total.store(0, memory_order_relaxed);
+    maximum.store(0, memory_order_relaxed);
+}
+
+int LatencyHistogram::bucket(int64_t ns) {
+    if (ns < kSubBuckets) {
+        return ns < 0 ? 0 : (int)ns;
+    }
+    // exponent of the leading bit, the next 3 bits pick the sub-bucket
+    int exponent = 63 - __builtin_clzll((unsigned long long)ns);
+    int sub = (int)((ns >> (exponent - 3)) & (kSubBuckets - 1));
+    return (exponent - 2) * kSubBuckets + sub;
+}
+
+int64_t LatencyHistogram::bucket_limit(int index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    int exponent = index / kSubBuckets + 2;
+    int sub = index % kSubBuckets;
+    return ((int64_t)(kSubBuckets + sub + 1) << (exponent - 3)) - 1;
+}
+
+void LatencyHistogram::record(int64_t ns) {
+    counts[bucket(ns)].fetch_add(1, memory_order_relaxed);
+    total.fetch_add(1, memory_order_relaxed);
+    int64_t seen = maximum.load(memory_order_relaxed);
+    while (ns > seen && !maximum.compare_exchange_weak(seen, ns, memory_order_relaxed)) {
+    }
+}
+
+int64_t LatencyHistogram::percentile(double p) const {
+    long n = count();
+    if (n == 0) {
+        return 0;
+    }
+    long rank = (long)(p * n);
+    long seen = 0;
+    for (int i = 0; i < kBuckets; i++) {
+        seen += counts[i].load(memory_order_relaxed);
+        if (seen > rank) {
+            return min(bucket_limit(i), max());
+        }
+    }
+    return max();
+}
+
+bool latency_enabled() {
+    return enabled.load(memory_order_relaxed);
+}
+
+void set_latency_enabled(bool on) {
+    enabled.store(on, memory_order_relaxed);
+}
+
+int64_t latency_start() {
+    if (!latency_enabled()) {
+        return 0;
+    }
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void latency_record(LatencyStage stage, int64_t start) {
+    int64_t now = latency_start();
+    if (start != 0 && now != 0) {
+        histograms[stage].record(now - start);
+    }
+}
+
+const LatencyHistogram &latency_histogram(LatencyStage stage) {
+    return histograms[stage];
+}
+
+const char *latency_stage_name(LatencyStage stage) {
+    return stage_names[stage];
+}
+
+static string milliseconds(int64_t ns) {
+    stringstream ss;
+    ss << fixed << setprecision(2) << ns / 1e6;
+    return ss.str();
+}
+
+vector<string> latency_summary() {
+    vector<string> lines;
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        const LatencyHistogram &h = histograms[i];
+        if (h.count() == 0) {
+            continue;
+        }
+        lines.push_back(string(stage_names[i]) + " " + milliseconds(h.percentile(0.5)) + "/" +
+                        milliseconds(h.percentile(0.95)) + "/" + milliseconds(h.percentile(0.99)) + "/" +
+                        milliseconds(h.max()) + " ms");
+    }
+    return lines;
+}
+
+bool write_latency_stats(const string &file_name, long dropped_frames) {
+    ofstream out(file_name.c_str());
+    if (!out) {
+        return false;
+    }
+    out << "stage,count,p50_ms,p95_ms,p99_ms,max_ms\n";
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        const LatencyHistogram &h = histograms[i];
+        out << stage_names[i] << "," << h.count() << "," << milliseconds(h.percentile(0.5)) << ","
+            << milliseconds(h.percentile(0.95)) << "," << milliseconds(h.percentile(0.99)) << ","
+            << milliseconds(h.max()) << "\n";
+    }
+    out << "dropped_frames," << dropped_frames << "\n";
+    return true;
+}
+
+LatencyTimer::~LatencyTimer() {
+    pause();
+    if (elapsed > 0) {
+        histograms[stage].record(elapsed);
+    }
+}
+
+void LatencyTimer::pause() {
+    int64_t now = latency_start();
+    if (start != 0 && now != 0) {
+        elapsed += now - start;
+    }
+    start = 0;
+}
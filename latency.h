@@ -0,0 +1,88 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Per stage latency histograms, off until set_latency_enabled(true). When
+ * off a timer costs one relaxed load and never reads the clock, so the
+ * instrumentation stays compiled into every build.
+ */
+enum LatencyStage {
+    LATENCY_CAPTURE,
+    LATENCY_GRAY,
+    LATENCY_DETECT,
+    LATENCY_LOCATE,
+    LATENCY_GAZE,
+    LATENCY_RENDER,
+    LATENCY_FRAME,
+    LATENCY_STAGE_COUNT
+};
+
+/*
+ * Lock-free log-linear histogram of durations in nanoseconds, 8 buckets per
+ * power of two (12.5% resolution), safe to record into from any thread
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(int64_t ns);
+    void reset();
+
+    long count() const { return total.load(std::memory_order_relaxed); }
+    int64_t max() const { return maximum.load(std::memory_order_relaxed); }
+    // upper bound of the bucket holding the p quantile, 0 when empty
+    int64_t percentile(double p) const;
+
+private:
+    static const int kSubBuckets = 8;
+    static const int kBuckets = 64 * kSubBuckets;
+
+    static int bucket(int64_t ns);
+    static int64_t bucket_limit(int index);
+
+    std::atomic<long> counts[kBuckets];
+    std::atomic<long> total;
+    std::atomic<int64_t> maximum;
+};
+
+bool latency_enabled();
+void set_latency_enabled(bool enabled);
+
+// clock in nanoseconds when enabled, 0 otherwise
+int64_t latency_start();
+// records the time since start, a start of 0 is ignored
+void latency_record(LatencyStage stage, int64_t start);
+
+const LatencyHistogram &latency_histogram(LatencyStage stage);
+const char *latency_stage_name(LatencyStage stage);
+
+// one "stage p50/p95/p99/max" line per stage that has samples, in ms
+std::vector<std::string> latency_summary();
+
+// table of every stage plus the dropped frame count, false if it can't be written
+bool write_latency_stats(const std::string &file_name, long dropped_frames);
+
+/*
+ * Times its own scope into a stage. resume()/pause() sum several spans of a
+ * frame into one sample, recorded on destruction.
+ */
+class LatencyTimer {
+public:
+    explicit LatencyTimer(LatencyStage stage, bool running = true)
+            : stage(stage), start(running ? latency_start() : 0), elapsed(0) {}
+    ~LatencyTimer();
+
+    void resume() { start = latency_start(); }
+    void pause();
+
+private:
+    LatencyStage stage;
+    int64_t start, elapsed;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include "luma.h"
+#include "opencv2/imgproc/imgproc.hpp"
+
+using namespace std;
+using namespace cv;
+
+bool parse_pixel_format(const string &name, PixelFormat &format) {
+    static const char *names[] = {"bgr", "bgra", "gray", "yuyv", "nv12"};
+    for (int i = 0; i <= PIXEL_NV12; i++) {
+        if (name == names[i]) {
+            format = (PixelFormat)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void raw_layout(PixelFormat format, Size size, int &rows, int &type) {
+    rows = size.height;
+    switch (format) {
+        case PIXEL_BGR: type = CV_8UC3; break;
+        case PIXEL_BGRA: type = CV_8UC4; break;
+        case PIXEL_GRAY: type = CV_8UC1; break;
+        case PIXEL_YUYV: type = CV_8UC2; break;
+        case PIXEL_NV12:
+            type = CV_8UC1;
+            rows = size.height * 3 / 2;
+            break;
+    }
+}
+
+size_t raw_frame_bytes(PixelFormat format, Size size) {
+    int rows, type;
+    raw_layout(format, size, rows, type);
+    return (size_t)rows * size.width * CV_ELEM_SIZE(type);
+}
+
+void luma_plane(const Mat &raw, PixelFormat format, Mat &dst) {
+    switch (format) {
+        case PIXEL_GRAY:
+            dst = raw;
+            break;
+        case PIXEL_NV12:
+            dst = raw.rowRange(0, raw.rows * 2 / 3);
+            break;
+        case PIXEL_YUYV:
+            extractChannel(raw, dst, 0);
+            break;
+        case PIXEL_BGR:
+        case PIXEL_BGRA:
+            cvtColor(raw, dst, COLOR_BGRA2GRAY);
+            break;
+    }
+}
+
+void raw_to_bgr(const Mat &raw, PixelFormat format, Mat &dst) {
+    switch (format) {
+        case PIXEL_GRAY: cvtColor(raw, dst, COLOR_GRAY2BGR); break;
+        case PIXEL_NV12: cvtColor(raw, dst, COLOR_YUV2BGR_NV12); break;
+        case PIXEL_YUYV: cvtColor(raw, dst, COLOR_YUV2BGR_YUY2); break;
+        case PIXEL_BGR: raw.copyTo(dst); break;
+        case PIXEL_BGRA: cvtColor(raw, dst, COLOR_BGRA2BGR); break;
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef LUMA_H
+#define LUMA_H
+
+#include <string>
+#include <opencv2/core/core.hpp>
+
+/*
+ * Layouts frames arrive in. The tracker only ever looks at luminance, so
+ * GRAY and NV12 frames are used in place (NV12's Y plane comes first) and
+ * YUYV only has its Y bytes picked out, no frame is converted to colour.
+ */
+enum PixelFormat {
+    PIXEL_BGR,
+    PIXEL_BGRA,
+    PIXEL_GRAY,
+    // Y0 U Y1 V, 2 bytes per pixel
+    PIXEL_YUYV,
+    // width x height Y plane followed by a half height interleaved UV plane
+    PIXEL_NV12
+};
+
+// "bgr", "bgra", "gray", "yuyv" or "nv12"
+bool parse_pixel_format(const std::string &name, PixelFormat &format);
+
+// rows and type of the Mat one width x height frame of format fills
+void raw_layout(PixelFormat format, cv::Size size, int &rows, int &type);
+// bytes in one tightly packed width x height frame
+size_t raw_frame_bytes(PixelFormat format, cv::Size size);
+
+/*
+ * Luminance of a frame laid out as raw_layout() says, in dst. For GRAY and
+ * NV12 dst is a view of raw's own Y plane, nothing is copied.
+ */
+void luma_plane(const cv::Mat &raw, PixelFormat format, cv::Mat &dst);
+
+// colour version of a raw frame, for showing it
+void raw_to_bgr(const cv::Mat &raw, PixelFormat format, cv::Mat &dst);
+
+#endif
@@ -4,6 +4,23 @@
 #include <fstream>
 #include "opencv2/imgproc/imgproc.hpp"
 #include "constants.h"
+#include "eye_center.h"
+#include "replay.h"
+#include "pipeline.h"
+#include "alloc_counter.h"
+#include "latency.h"
+#include "gaze_log.h"
+#include "cascade_cache.h"
+#include "shape_renderer.h"
+#include "gaze_targets.h"
+#include "eye_tracker.h"
+#include "batch.h"
+#include "quality.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
 #include <sys/stat.h>
 
 using namespace std;
@@ -14,16 +31,15 @@ using namespace cv;
 #define CLUSTERING 1
 
 Rect screen;
+bool headless = false;
+// latency percentiles drawn over whatever is shown, toggled with 'l'
+bool showLatency = false;
+long droppedFrames = 0;
+// draws the shape screen, only what changed each frame
+ShapeRenderer shapeRenderer;
+GazeTargets gazeTargets;
+DwellTracker dwellTracker(kDwellSelectMs);
 
-typedef struct {
-    Point CenterPointOfEyes;
-    Point OffsetFromEyeCenter;
-    int eyeLeftMax=0;//13;
-    int eyeRightMax=0;//13;
-    int eyeTopMax=0;//11;
-    int eyeBottomMax=0;//11;
-    int count = 0;
-} EyeSettingsSt;
 EyeSettingsSt EyeSettings;
 
 vector<string> &split(const string &s, char delim, vector<string> &elems) {
@@ -41,194 +57,8 @@ vector<string> split(const string &s, char delim) {
     return elems;
 }
 
-void scale(const Mat &src,Mat &dst) {
-    cv::resize(src, dst, cv::Size(kFastEyeWidth,(((float)kFastEyeWidth)/src.cols) * src.rows));
-}
-
-Point unscale_point(Point p, Rect origSize) {
-    float ratio = (((float)kFastEyeWidth)/origSize.width);
-    int x = round(p.x / ratio);
-    int y = round(p.y / ratio);
-    return Point(x,y);
-}
-
-Mat matrix_magnitude(Mat mat_x, Mat mat_y) {
-    Mat mag(mat_x.rows, mat_x.cols, CV_64F);
-
-    for (int y = 0; y < mat_x.rows; y++) {
-        const double *x_row = mat_x.ptr<double>(y), *y_row = mat_y.ptr<double>(y);
-        double *mag_row = mag.ptr<double>(y);
-        for (int x = 0; x < mat_x.cols; x++) {
-            double gx = x_row[x], gy = y_row[x];
-            double magnitude = sqrt((gx * gx) + (gy * gy));
-            mag_row[x] = magnitude;
-        }
-    }
-    return mag;
-}
-
-
-/*
- * Find possible center in gradient location
- * doesn't use the postprocessing weight of color (section 2.1)
- */
-void possible_centers(int x, int y, const Mat &blurred, double gx, double gy, Mat &output) {
-
-    for (int cy = 0; cy < output.rows; cy++) {
-        double *output_row = output.ptr<double>(cy);
-        for (int cx = 0; cx < output.cols; cx++) {
-            if (x == cx && y == cy) {
-                continue;
-            }
-            // equation (2)
-            double dx = x - cx;
-            double dy = y - cy;
-            double magnitude = sqrt((dx * dx) + (dy * dy));
-            dx = dx / magnitude;
-            dy = dy / magnitude;
-
-            double dotProduct = (dx*gx + dy*gy);
-            // ignores vectors pointing in opposite direction/negative dot products
-            dotProduct = max(0.0, dotProduct);
-
-            // summation
-            output_row[cx] += dotProduct * dotProduct;
-        }
-    }
-}
-
-/*
- * Imitate Matlab gradiant function, to better match results from paper
- */
-Mat computeMatXGradient(const Mat &mat) {
-    Mat out(mat.rows,mat.cols,CV_64F);
-
-    for (int y = 0; y < mat.rows; ++y) {
-        const uchar *Mr = mat.ptr<uchar>(y);
-        double *Or = out.ptr<double>(y);
-
-        Or[0] = Mr[1] - Mr[0];
-        for (int x = 1; x < mat.cols - 1; ++x) {
-            Or[x] = (Mr[x+1] - Mr[x-1])/2.0;
-        }
-        Or[mat.cols-1] = Mr[mat.cols-1] - Mr[mat.cols-2];
-    }
-
-    return out;
-}
-
-/*
- * Finds the pupils within the given eye region
- * returns points of where pupil is calculated to be
- *
- * face_image: image of face region from frame
- * eye_region: dimensions of eye region
- * window_name: display window name
- */
-Point find_centers(Mat face_image, Rect eye_region) {
-
-    Mat eye_unscaled = face_image(eye_region);
-
-    // scale and grey image
-    Mat eye_scaled_gray;
-    scale(eye_unscaled, eye_scaled_gray);
-    cvtColor(eye_scaled_gray, eye_scaled_gray, COLOR_BGRA2GRAY);
-
-    // get the gradient of eye regions
-    Mat gradient_x, gradient_y;
-    gradient_x = computeMatXGradient(eye_scaled_gray);
-    //Sobel(eye_scaled_gray, gradient_x, CV_64F, 1, 0, 5);
-    gradient_y = computeMatXGradient(eye_scaled_gray.t()).t();
-    //Sobel(eye_scaled_gray, gradient_y, CV_64F, 0, 1, 5);
-
-    //Mat magnitude = matrix_magnitude(gradient_x, gradient_y);
-
-    // normalized displacement vectors
-    normalize(gradient_x, gradient_x);
-    normalize(gradient_y, gradient_y);
-
-    // blur and invert the image
-    Mat blurred;
-    GaussianBlur(eye_scaled_gray, blurred, Size(5, 5), 0, 0);
-    bitwise_not(blurred, blurred);
-    //increase contrast and decrease brightness
-    for( int y = 0; y < blurred.rows; y++ )
-    {
-        for( int x = 0; x < blurred.cols; x++ )
-        {
-            for( int c = 0; c < 3; c++ )
-            {
-                blurred.at<Vec3b>(y,x)[c] = saturate_cast<uchar>(1.01*( blurred.at<Vec3b>(y,x)[c] ) - 10 );
-            }
-        }
-    }
-
-    //imshow("window", blurred);
-
-    Mat outSum = Mat::zeros(eye_scaled_gray.rows, eye_scaled_gray.cols, CV_64F);
-
-    for (int y = 0; y < blurred.rows; y++) {
-        const double *x_row = gradient_x.ptr<double>(y), *y_row = gradient_y.ptr<double>(y);
-        for (int x = 0; x < blurred.cols; x++) {
-            double gx = x_row[x], gy = y_row[x];
-            if (gx == 0.0 && gy == 0.0) {
-                continue;
-            }
-            possible_centers(x, y, blurred, gx, gy, outSum);
-        }
-    }
-
-    double numGradients = (blurred.rows*blurred.cols);
-    Mat out;
-    outSum.convertTo(out, CV_32F, 1.0/numGradients);
-
-    Point max_point;
-    double max_value;
-    minMaxLoc(out, NULL, &max_value, NULL, &max_point);
-
-    Point pupil = unscale_point(max_point, eye_region);
-    return pupil;
-}
-
-/*
- * returns an array of points of the pupils
- * [left pupil, right pupil]
- *
- * color_image: image of the whole frame
- * face: dimensions of face in color_image
- */
-void find_eyes(Mat color_image, Rect face, Point &left_pupil_dst, Point &right_pupil_dst, Rect &left_eye_region_dst, Rect &right_eye_region_dst) {
-    // image of face
-    Mat face_image = color_image(face);
-
-    int eye_width = face.width * (kEyePercentWidth/100.0);
-    int eye_height = face.height * (kEyePercentHeight/100.0);
-    int eye_top = face.height * (kEyePercentTop/100.0);
-    int eye_side = face.width * (kEyePercentSide/100.0);
-    int right_eye_x = face.width - eye_width -  eye_side;
-
-    // eye regions
-    Rect left_eye_region(eye_side, eye_top, eye_width, eye_height);
-    Rect right_eye_region(right_eye_x, eye_top, eye_width, eye_height);
-
-    // get points of pupils within eye region
-    Point left_pupil = find_centers(face_image, left_eye_region);
-    Point right_pupil = find_centers(face_image, right_eye_region);
-
-    // convert points to fit on frame image
-    right_pupil.x += right_eye_region.x;
-    right_pupil.y += right_eye_region.y;
-    left_pupil.x += left_eye_region.x;
-    left_pupil.y += left_eye_region.y;
-
-
-    left_pupil_dst = left_pupil;
-    right_pupil_dst = right_pupil;
-    left_eye_region_dst = left_eye_region;
-    right_eye_region_dst = right_eye_region;
-}
-
-void display_eyes(Mat color_image, Rect face, Point left_pupil, Point right_pupil, Rect left_eye_region, Rect right_eye_region, int record = 0, bool doCalibration = false) {
+void display_eyes(Mat color_image, Rect face, Point left_pupil, Point right_pupil, Rect left_eye_region, Rect right_eye_region, int record = 0, bool doCalibration = false,
+                  const LocatorStats *left_stats = NULL, const LocatorStats *right_stats = NULL) {
     Mat face_image = color_image(face);
 
     // draw eye regions
@@ -245,30 +75,34 @@ void display_eyes(Mat color_image, Rect face, Point left_pupil, Point right_pupi
     circle(face_image, left_pupil, 3, Scalar(0, 255, 0));
     //circle(face_image, center, 3, Scalar(255, 0, 0));
 
-    std::string left_eye_region_width = std::to_string(left_eye_region.x + (left_eye_region.width/2));
-    std::string left_eye_region_height = std::to_string(left_eye_region.y + (left_eye_region.height/2));
-
-    std::string right_eye_region_width = std::to_string(right_eye_region.x + (right_eye_region.width/2));
-    std::string right_eye_region_height = std::to_string(right_eye_region.y + (right_eye_region.height/2));
-
-    std::string xleft_pupil_string = std::to_string(left_pupil.x);
-    std::string yleft_pupil_string = std::to_string(left_pupil.y);
-
-    std::string xright_pupil_string = std::to_string(right_pupil.x);
-    std::string yright_pupil_string = std::to_string(right_pupil.y);
-
-    String text1 = "Pupil(L,R): ([" + xleft_pupil_string + "," + yleft_pupil_string + "],[" + xright_pupil_string + "," + yright_pupil_string + "])";
-    String text2 = "Center(L,R): ([" + left_eye_region_width + ", " + left_eye_region_height +"]," + "[" + right_eye_region_width + ", " + right_eye_region_height +"])";
+    int left_center_x = left_eye_region.x + (left_eye_region.width/2);
+    int left_center_y = left_eye_region.y + (left_eye_region.height/2);
+    int right_center_x = right_eye_region.x + (right_eye_region.width/2);
+    int right_center_y = right_eye_region.y + (right_eye_region.height/2);
 
     if (doCalibration && record) {
-        cout << xleft_pupil_string << "," << yleft_pupil_string << ";"
-             << xright_pupil_string << "," << yright_pupil_string << ";"
-             << left_eye_region_width << "," << left_eye_region_height << ";"
-             << right_eye_region_width << "," << right_eye_region_height << ";";
+        cout << left_pupil.x << "," << left_pupil.y << ";"
+             << right_pupil.x << "," << right_pupil.y << ";"
+             << left_center_x << "," << left_center_y << ";"
+             << right_center_x << "," << right_center_y << ";";
     }
 
-    //add data
-    putText (color_image, text1 + " " + text2, cvPoint(20,700), FONT_HERSHEY_SIMPLEX, double(1), Scalar(255,0,0));
+    //add data, formatted in place rather than from a dozen temporary strings
+    char text[160];
+    snprintf(text, sizeof(text), "Pupil(L,R): ([%d,%d],[%d,%d]) Center(L,R): ([%d, %d],[%d, %d])",
+             left_pupil.x, left_pupil.y, right_pupil.x, right_pupil.y,
+             left_center_x, left_center_y, right_center_x, right_center_y);
+    putText (color_image, text, cvPoint(20,700), FONT_HERSHEY_SIMPLEX, double(1), Scalar(255,0,0));
+
+    if (left_stats && right_stats) {
+        snprintf(text, sizeof(text), "Voters(L,R): (%d/%d,%d/%d)", left_stats->voters, left_stats->gradients,
+                 right_stats->voters, right_stats->gradients);
+        putText (color_image, text, cvPoint(20,740), FONT_HERSHEY_SIMPLEX, double(1), Scalar(255,0,0));
+        if (left_stats->candidates > 0 || right_stats->candidates > 0) {
+            snprintf(text, sizeof(text), "Candidates(L,R): (%d,%d)", left_stats->candidates, right_stats->candidates);
+            putText (color_image, text, cvPoint(20,780), FONT_HERSHEY_SIMPLEX, double(1), Scalar(255,0,0));
+        }
+    }
 }
 
 void display_googley_eyes(Mat color_image, Rect face, Point left_pupil, Point right_pupil, Rect left_eye_region, Rect right_eye_region) {
@@ -287,62 +121,89 @@ void display_googley_eyes(Mat color_image, Rect face, Point left_pupil, Point ri
 
 }
 
-Point closestPoint(vector<Point> shapes, Point guess){
-    int best_dist = -1;
-    Point best_point;
+void display_shapes_on_screen(Mat &background, const GazeTargets &targets, Point guess, unsigned char showGuess) {
+    int highlighted = targets.nearest(guess);
+    //display calibration points
+    bool markers[MARKER_COUNT];
+    markers[MARKER_TOP] = EyeSettings.eyeTopMax;
+    markers[MARKER_RIGHT] = EyeSettings.eyeRightMax;
+    markers[MARKER_BOTTOM] = EyeSettings.eyeBottomMax;
+    markers[MARKER_LEFT] = EyeSettings.eyeLeftMax;
 
-    for (Point s: shapes) {
-        int dist = pow(s.x - guess.x, 2) + pow(s.y - guess.y, 2);
-        if (best_dist == -1 or dist < best_dist) {
-            best_dist = dist;
-            best_point = s;
-        }
-    }
-    return best_point;
+    shapeRenderer.draw(background, targets.targets(), highlighted, guess, showGuess, markers);
 }
 
-void display_shapes_on_screen(Mat background, vector<Point> shapes, Point guess, unsigned char showGuess) {
-    background.setTo(cv::Scalar(255,255,255));
-
-    Point best_point = closestPoint(shapes, guess);
-
-    for (Point s : shapes) {
-        if (s == best_point) {
-            circle(background, s, 20, Scalar(0,255,0), -1);
-            circle(background, s, 20, Scalar(0,0,0), 2);
-        } else {
-            circle(background, s, 20, Scalar(0,0,255), -1);
-            circle(background, s, 20, Scalar(0,0,0), 2);
+void show_window(const Mat &image) {
+    if (headless) {
+        return;
+    }
+    if (showLatency) {
+        // drawn into the image itself, the shape renderer restores it next frame
+        Mat shown = image;
+        vector<string> lines = latency_summary();
+        lines.push_back("dropped frames " + to_string(droppedFrames));
+        for (size_t i = 0; i < lines.size(); i++) {
+            putText(shown, lines[i], Point(20, shown.rows - 20 - 22 * (lines.size() - 1 - i)),
+                    FONT_HERSHEY_SIMPLEX, 0.6, Scalar(0, 0, 255));
         }
+        shapeRenderer.invalidate(Rect(0, shown.rows - 40 - 22 * lines.size(), shown.cols, 40 + 22 * lines.size()));
     }
-    if(showGuess==1) {
-        circle(background, guess, 5, Scalar(0, 0, 255), -1);
-    }else if(showGuess==2){
-        circle(background, guess, 5, Scalar(0, 0, 0), -1);
+    imshow("window", image);
+}
+
+/*
+ * one line per processed frame: face, pupils (frame coordinates) and gaze,
+ * -1 where there was no face or no calibration yet
+ */
+void write_frame_record(ostream &out, int frame_index, const vector<Rect> &faces, Point left_pupil, Point right_pupil, Point gaze,
+                        int quality) {
+    if (faces.size() > 0) {
+        const Rect &face = faces[0];
+        out << frame_index << "," << face.x << "," << face.y << "," << face.width << "," << face.height << ","
+            << left_pupil.x + face.x << "," << left_pupil.y + face.y << ","
+            << right_pupil.x + face.x << "," << right_pupil.y + face.y << ",";
+    } else {
+        out << frame_index << ",-1,-1,-1,-1,-1,-1,-1,-1,";
     }
+    out << gaze.x << "," << gaze.y << "," << quality << "\n";
+}
 
+static GazeLogRect log_rect(Rect r) {
+    GazeLogRect out = {r.x, r.y, r.width, r.height};
+    return out;
+}
 
-    //display calibration points
-    if(EyeSettings.eyeTopMax) {
-        circle(background, Point(background.cols / 2, 0), 5, Scalar(0, 255,0), -1);
-    }else{
-        circle(background, Point(background.cols / 2, 0), 5, Scalar(0, 0, 255), -1);
-    }
-    if(EyeSettings.eyeRightMax) {
-        circle(background, Point(background.cols, background.rows / 2), 5, Scalar(0, 255,0), -1);
-    }else{
-        circle(background, Point(background.cols, background.rows / 2), 5, Scalar(0, 0,255), -1);
-    }
-    if(EyeSettings.eyeBottomMax) {
-        circle(background, Point(background.cols / 2, background.rows), 5, Scalar(0, 255,0), -1);
-    }else{
-        circle(background, Point(background.cols / 2, background.rows), 5, Scalar(0, 0,255), -1);
-    }
-    if(EyeSettings.eyeLeftMax) {
-        circle(background, Point(0, background.rows / 2), 5, Scalar(0, 255,0), -1);
-    }else{
-        circle(background, Point(0, background.rows / 2), 5, Scalar(0, 0,255), -1);
+static GazeLogPoint log_point(Point p) {
+    GazeLogPoint out = {p.x, p.y};
+    return out;
+}
+
+/*
+ * one binary log sample per processed frame, as write_frame_record with the
+ * eye regions, calibration offset and the shape being recorded added
+ */
+void write_gaze_sample(GazeLog &log, int frame_index, const vector<Rect> &faces, Rect left_eye, Rect right_eye,
+                       Point left_pupil, Point right_pupil, Point gaze, Point target) {
+    GazeSample sample;
+    memset(&sample, 0, sizeof(sample));
+    sample.timestamp = chrono::duration_cast<chrono::nanoseconds>(
+            chrono::system_clock::now().time_since_epoch()).count();
+    sample.frame = frame_index;
+    if (faces.size() > 0) {
+        const Rect &face = faces[0];
+        sample.face = log_rect(face);
+        sample.leftEye = log_rect(left_eye + face.tl());
+        sample.rightEye = log_rect(right_eye + face.tl());
+        sample.leftPupil = log_point(left_pupil + face.tl());
+        sample.rightPupil = log_point(right_pupil + face.tl());
+    } else {
+        sample.face = sample.leftEye = sample.rightEye = log_rect(Rect(-1, -1, -1, -1));
+        sample.leftPupil = sample.rightPupil = log_point(Point(-1, -1));
     }
+    sample.offset = log_point(EyeSettings.OffsetFromEyeCenter);
+    sample.gaze = log_point(gaze);
+    sample.target = log_point(target);
+    log.append(sample);
 }
 
 void ListenForCalibrate(int wait_key, Mat frame) {
@@ -352,25 +213,25 @@ void ListenForCalibrate(int wait_key, Mat frame) {
     //top calibration 119
     switch (wait_key) {
         case 97:
-            EyeSettings.eyeLeftMax = abs(EyeSettings.OffsetFromEyeCenter.x);
+            calibrate_edge(EyeSettings, CALIBRATE_LEFT);
             #if DEBUG
             imwrite("test/calib-left.png", frame);
             #endif
             break;
         case 100:
-            EyeSettings.eyeRightMax = abs(EyeSettings.OffsetFromEyeCenter.x);
+            calibrate_edge(EyeSettings, CALIBRATE_RIGHT);
             #if DEBUG
             imwrite("test/calib-right.png", frame);
             #endif
             break;
         case 115:
-            EyeSettings.eyeBottomMax = abs(EyeSettings.OffsetFromEyeCenter.y);
+            calibrate_edge(EyeSettings, CALIBRATE_BOTTOM);
             #if DEBUG
             imwrite("test/calib-bot.png", frame);
             #endif
             break;
         case 119:
-            EyeSettings.eyeTopMax = abs(EyeSettings.OffsetFromEyeCenter.y);
+            calibrate_edge(EyeSettings, CALIBRATE_TOP);
             #if DEBUG
             imwrite("test/calib-top.png", frame);
             #endif
@@ -416,6 +277,7 @@ vector<Point> find_regions_centers(Mat shapes_image, int x_regions, int y_region
 
 
 int main(int argc, char* argv[]) {
+    double launch_ticks = getTickCount();
     bool doImport = false;
     bool doExport = false;
     bool doCalibrate = true;
@@ -426,7 +288,26 @@ int main(int argc, char* argv[]) {
     bool hasFile = false;
     int shapes_x = -1;
     int shapes_y = -1;
+    string targets_name;
+    vector<string> batch_inputs;
+    string batch_dir = "batch";
+    int jobs = 0;
+    // frame time the quality scheduler holds, 0 for always full quality
+    double budget_ms = 0.0;
+    bool luma = false;
+    PixelFormat raw_format = PIXEL_GRAY;
+    Size raw_size;
     fstream file;
+    string input;
+    int repeat = 1;
+    KeyScript key_script;
+    ofstream output_file;
+    bool threaded = false;
+    bool trackFaces = false;
+    bool multiFace = false;
+    string stats_name;
+    string cascade_name = "haar_data/haarcascade_frontalface_alt.xml";
+    GazeLog gaze_log;
 
     for(int i = 1; i < argc; i++) {
         if (string("-").compare(string(argv[i]).substr(0,1)) == 0) {
@@ -462,6 +343,146 @@ int main(int argc, char* argv[]) {
                     cerr << "ERROR: please enter a file name!";
                     exit(1);
                 }
+            } else if (string("--sparse").compare(argv[i]) == 0 || string("-s").compare(argv[i]) == 0) {
+                LocatorSettings.sparseGradients = true;
+            } else if (string("--pyramid").compare(argv[i]) == 0 || string("-p").compare(argv[i]) == 0) {
+                LocatorSettings.pyramid = true;
+            } else if (string("--fft").compare(argv[i]) == 0 || string("-a").compare(argv[i]) == 0) {
+                LocatorSettings.fftObjective = true;
+            } else if (string("--predict").compare(argv[i]) == 0 || string("-y").compare(argv[i]) == 0) {
+                LocatorSettings.predictive = true;
+            } else if (string("--weight").compare(argv[i]) == 0 || string("-W").compare(argv[i]) == 0) {
+                LocatorSettings.darkWeight = true;
+            } else if (string("--parallel-votes").compare(argv[i]) == 0 || string("-V").compare(argv[i]) == 0) {
+                LocatorSettings.parallelVotes = true;
+            } else if (string("--input").compare(argv[i]) == 0 || string("-I").compare(argv[i]) == 0) {
+                if (i+1 < argc) {
+                    input = argv[++i];
+                } else {
+                    cerr << "ERROR: please enter a video, image, directory or glob!";
+                    exit(1);
+                }
+            } else if (string("--headless").compare(argv[i]) == 0 || string("-H").compare(argv[i]) == 0) {
+                headless = true;
+            } else if (string("--repeat").compare(argv[i]) == 0 || string("-r").compare(argv[i]) == 0) {
+                if (i+1 < argc && atoi(argv[i+1]) > 0) {
+                    repeat = atoi(argv[++i]);
+                } else {
+                    cerr << "ERROR: please enter a repeat count!";
+                    exit(1);
+                }
+            } else if (string("--keys").compare(argv[i]) == 0 || string("-k").compare(argv[i]) == 0) {
+                if (i+1 < argc && key_script.load(argv[i+1])) {
+                    i++;
+                } else {
+                    cerr << "ERROR: keys must be FRAME:KEY entries, e.g. 10:a,20:d,30:space!";
+                    exit(1);
+                }
+            } else if (string("--output").compare(argv[i]) == 0 || string("-o").compare(argv[i]) == 0) {
+                if (i+1 < argc) {
+                    output_file.open(argv[++i]);
+                    if (!output_file) {
+                        cerr << "Failed to open <" << argv[i] << ">!";
+                        exit(1);
+                    }
+                } else {
+                    cerr << "ERROR: please enter an output file name!";
+                    exit(1);
+                }
+            } else if (string("--threaded").compare(argv[i]) == 0 || string("-P").compare(argv[i]) == 0) {
+                threaded = true;
+            } else if (string("--track").compare(argv[i]) == 0 || string("-x").compare(argv[i]) == 0) {
+                trackFaces = true;
+            } else if (string("--multi-face").compare(argv[i]) == 0 || string("-m").compare(argv[i]) == 0) {
+                multiFace = true;
+            } else if (string("--cascade").compare(argv[i]) == 0 || string("-C").compare(argv[i]) == 0) {
+                if (i+1 < argc) {
+                    cascade_name = argv[++i];
+                } else {
+                    cerr << "ERROR: please enter a cascade file!";
+                    exit(1);
+                }
+            } else if (string("--batch").compare(argv[i]) == 0 || string("-B").compare(argv[i]) == 0) {
+                if (i+1 < argc) {
+                    batch_inputs.push_back(argv[++i]);
+                } else {
+                    cerr << "ERROR: please enter a video or image directory to process!";
+                    exit(1);
+                }
+            } else if (string("--batch-dir").compare(argv[i]) == 0 || string("-D").compare(argv[i]) == 0) {
+                if (i+1 < argc) {
+                    batch_dir = argv[++i];
+                } else {
+                    cerr << "ERROR: please enter a directory for the batch results!";
+                    exit(1);
+                }
+            } else if (string("--jobs").compare(argv[i]) == 0 || string("-j").compare(argv[i]) == 0) {
+                if (i+1 < argc && atoi(argv[i+1]) >= 0) {
+                    jobs = atoi(argv[++i]);
+                } else {
+                    cerr << "ERROR: jobs must be a count of threads, 0 for all cores!";
+                    exit(1);
+                }
+            } else if (string("--luma").compare(argv[i]) == 0 || string("-Y").compare(argv[i]) == 0) {
+                luma = true;
+            } else if (string("--raw").compare(argv[i]) == 0 || string("-z").compare(argv[i]) == 0) {
+                // FORMAT:WIDTHxHEIGHT, e.g. nv12:640x480
+                vector<string> rawArgs = i+1 < argc ? split(argv[i+1], ':') : vector<string>();
+                int raw_width = 0, raw_height = 0;
+                if (rawArgs.size() == 2 && parse_pixel_format(rawArgs[0], raw_format) &&
+                    sscanf(rawArgs[1].c_str(), "%dx%d", &raw_width, &raw_height) == 2 && raw_width > 0 && raw_height > 0) {
+                    raw_size = Size(raw_width, raw_height);
+                    i++;
+                } else {
+                    cerr << "ERROR: raw input must be FORMAT:WIDTHxHEIGHT with FORMAT one of bgr, bgra, gray, yuyv, nv12!";
+                    exit(1);
+                }
+            } else if (string("--budget").compare(argv[i]) == 0 || string("-b").compare(argv[i]) == 0) {
+                if (i+1 < argc && atof(argv[i+1]) > 0) {
+                    budget_ms = atof(argv[++i]);
+                } else {
+                    cerr << "ERROR: please enter a frame time budget in milliseconds!";
+                    exit(1);
+                }
+            } else if (string("--fps").compare(argv[i]) == 0 || string("-R").compare(argv[i]) == 0) {
+                if (i+1 < argc && atof(argv[i+1]) > 0) {
+                    budget_ms = 1000.0 / atof(argv[++i]);
+                } else {
+                    cerr << "ERROR: please enter a target frame rate!";
+                    exit(1);
+                }
+            } else if (string("--targets").compare(argv[i]) == 0 || string("-G").compare(argv[i]) == 0) {
+                if (i+1 < argc) {
+                    targets_name = argv[++i];
+                } else {
+                    cerr << "ERROR: please enter a targets file!";
+                    exit(1);
+                }
+            } else if (string("--log").compare(argv[i]) == 0 || string("-L").compare(argv[i]) == 0) {
+                if (i+1 < argc) {
+                    if (!gaze_log.open(argv[++i])) {
+                        cerr << "Failed to open <" << argv[i] << ">!";
+                        exit(1);
+                    }
+                } else {
+                    cerr << "ERROR: please enter a log file name!";
+                    exit(1);
+                }
+            } else if (string("--stats").compare(argv[i]) == 0 || string("-S").compare(argv[i]) == 0) {
+                if (i+1 < argc) {
+                    stats_name = argv[++i];
+                    set_latency_enabled(true);
+                } else {
+                    cerr << "ERROR: please enter a stats file name!";
+                    exit(1);
+                }
+            } else if (string("--vote-engine").compare(argv[i]) == 0 || string("-v").compare(argv[i]) == 0) {
+                if (i+1 < argc && parse_vote_engine(argv[i+1], LocatorSettings.voteEngine)) {
+                    i++;
+                } else {
+                    cerr << "ERROR: vote engine must be one of reference, auto, scalar, sse, avx2!";
+                    exit(1);
+                }
             } else {
                 cerr << "ERROR: No argument <" << argv[i] << "> exists!";
                 exit(1);
@@ -473,7 +494,11 @@ int main(int argc, char* argv[]) {
         } else {
             cerr << "ERROR: Incorrect number of arguments!\n" <<
                     "Syntax main [--import|-i] [--export|-e] [--calibrate|-c] [--test| -T] [--train|-t] " <<
-                    "[--show-cam|-w] [--filename|-f CALIBRATION_FILE] [SHAPES_X SHAPES_Y]";
+                    "[--show-cam|-w] [--filename|-f CALIBRATION_FILE] [--vote-engine|-v ENGINE] [--sparse|-s] [--pyramid|-p] [--fft|-a] [--predict|-y] [--weight|-W] [--parallel-votes|-V] " <<
+                    "[--input|-I VIDEO|IMAGE|DIR|GLOB] [--repeat|-r N] [--headless|-H] [--keys|-k FRAME:KEY,...] " <<
+                    "[--output|-o FILE] [--threaded|-P] [--track|-x] [--multi-face|-m] [--stats|-S FILE] [--log|-L FILE] [--cascade|-C CASCADE_XML] [--targets|-G TARGETS_FILE] " <<
+                    "[--batch|-B VIDEO|DIR|GLOB]... [--batch-dir|-D DIR] [--jobs|-j N] " <<
+                    "[--budget|-b MS] [--fps|-R FPS] [--luma|-Y] [--raw|-z FORMAT:WxH] [SHAPES_X SHAPES_Y]";
             exit(1);
         }
     }
@@ -507,6 +532,18 @@ int main(int argc, char* argv[]) {
             }
         }
 
+    // offline runs over recordings, no window or calibration
+    if (!batch_inputs.empty()) {
+        BatchStats batch_stats;
+        if (!run_batch(batch_inputs, batch_dir, cascade_name, jobs, &batch_stats)) {
+            exit(1);
+        }
+        cerr << "Batch: " << batch_stats.frames << " frames (" << batch_stats.faces << " with a face) from "
+             << batch_stats.inputs << " inputs in " << batch_stats.seconds << " s, " << batch_stats.framesPerSecond
+             << " frames/s on " << batch_stats.threads << " threads, results in <" << batch_dir << ">" << endl;
+        return 0;
+    }
+
     const int height = 800;
     const int width = 1440;
 
@@ -518,40 +555,173 @@ int main(int argc, char* argv[]) {
     cvInitFont(&font,CV_FONT_HERSHEY_SIMPLEX|CV_FONT_ITALIC, hScale,vScale,0,lineWidth);
 
     CascadeClassifier face_cascade;
-    face_cascade.load("haar_data/haarcascade_frontalface_alt.xml");
+    CascadeLoadInfo cascade_info;
+    if (!load_cascade(face_cascade, cascade_name, kCascadeCacheDir, &cascade_info)) {
+        cerr << "Failed to load <" << cascade_name << ">!";
+        exit(1);
+    }
+    cerr << "Loaded <" << cascade_name << "> " << (cascade_info.fromCache ? "from the compacted copy <" + cascade_info.cacheFile + ">" : "from source")
+         << " in " << cascade_info.milliseconds << " ms" << (cascade_info.cacheWritten ? ", cache written" : "") << endl;
+
+    // every face's eyes are located concurrently, each face keeps its own calibration
+    unique_ptr<ThreadPool> face_pool;
+    unique_ptr<MultiFaceLocator> multi_face;
+    if (multiFace) {
+        face_pool.reset(new ThreadPool());
+        multi_face.reset(new MultiFaceLocator(*face_pool));
+    }
+    EyeTracker tracker(face_cascade, multi_face.get());
+    FaceTracker &face_tracker = tracker.faceTracker();
+    face_tracker.setTracking(trackFaces);
+    face_tracker.setAllFaces(multiFace);
+    map<int, EyeSettingsSt> face_settings;
+    const EyeSettingsSt default_settings = EyeSettings;
+
+    if (headless && input.empty()) {
+        cerr << "You must define an input to run headless! --input <VIDEO|GLOB>";
+        exit(1);
+    }
 
-    VideoCapture cap(0);
-    if (!cap.isOpened()) {
+    // luminance frames are located as they are and drawn on in grey, nothing
+    // is converted to colour
+    FrameSource source;
+    source.setLuma(luma);
+    if (raw_size.area() > 0) {
+        source.setRawFormat(raw_format, raw_size);
+    }
+    if (!source.open(input, repeat)) {
         return -1;
     }
 
-    namedWindow("window");
-    Mat frame, shape_screen;
+    if (!headless) {
+        namedWindow("window");
+    }
+    Mat shape_screen;
     shape_screen = Mat(height,width, CV_8UC3);
-    cap >> frame;
 
-    vector<Point> region_centers = find_regions_centers(shape_screen, shapes_x, shapes_y);
+    // live capture always shows the newest frame, replays process every frame
+    Pipeline pipeline(source, face_tracker, source.isLive() ? QUEUE_LATEST : QUEUE_BLOCK, multi_face.get());
+    if (threaded) {
+        pipeline.start();
+    }
+    int frames = 0;
+
+    // per frame results go to the output file, or stdout when replaying headless
+    ostream *records = output_file.is_open() ? &output_file : (headless ? &cout : NULL);
+    // and then everything else printed per frame moves to stderr, out of the records' way
+    ostream &console = records == &cout ? cerr : cout;
+    if (records) {
+        *records << "frame,face_x,face_y,face_w,face_h,left_x,left_y,right_x,right_y,gaze_x,gaze_y,quality\n";
+    }
+    double start_ticks = getTickCount();
+
+    // a targets file replaces the SHAPES_X x SHAPES_Y grid
+    if (!targets_name.empty()) {
+        if (!gazeTargets.load(targets_name)) {
+            cerr << "ERROR: Malformed targets file <" << targets_name << ">!";
+            exit(1);
+        }
+    } else {
+        gazeTargets.setTargets(find_regions_centers(shape_screen, shapes_x, shapes_y));
+    }
+    const vector<Point> &region_centers = gazeTargets.targets();
     //random_shuffle(region_centers.begin(), region_centers.end());
 
     int count = 0;
     int record = 0;
     int currentShape=-1;
+
+    // trades detection and locating quality for frame time when given a budget
+    QualityScheduler scheduler;
+    scheduler.setBudget(budget_ms);
+
+    // frame arena, the job and its buffers are reused by every iteration
+    FrameJob job;
+    unsigned long loop_allocs = 0, locate_allocs = 0;
     while (1) {
-        Mat gray_image;
-        vector<Rect> faces;
-        cvtColor(frame, gray_image, COLOR_BGRA2GRAY);
+        unsigned long allocs_at_start = allocation_count();
+        double frame_ticks = getTickCount();
+        LatencyTimer frame_timer(LATENCY_FRAME);
+        // drawing and showing, summed over the frame
+        LatencyTimer render_timer(LATENCY_RENDER, false);
+        if (threaded) {
+            if (!pipeline.pop(job)) {
+                break;
+            }
+        } else {
+            int64_t capture_start = latency_start();
+            bool more = source.read(job.frame);
+            latency_record(LATENCY_CAPTURE, capture_start);
+            if (!more) {
+                break;
+            }
+            job.index = source.frameIndex();
+            // a skipped frame is shown with the last frame's faces and pupils
+            if (scheduler.shouldProcess()) {
+                tracker.detect(job);
+                unsigned long allocs_before_locate = allocation_count();
+                tracker.locate(job);
+                if (frames > 0) {
+                    locate_allocs += allocation_count() - allocs_before_locate;
+                }
+            }
+            job.quality = scheduler.level().level;
+        }
+        frames++;
+        if (frames == 1) {
+            cerr << "First frame " << (getTickCount() - launch_ticks) * 1000.0 / getTickFrequency() << " ms after launch" << endl;
+        }
 
-        face_cascade.detectMultiScale(gray_image, faces, 1.1, 2, 0|CV_HAAR_SCALE_IMAGE|CV_HAAR_FIND_BIGGEST_OBJECT);
+        // calibration and gaze follow the oldest face
+        int primary_id = job.people.size() > 0 ? job.people[0].id : -1;
+        if (primary_id >= 0) {
+            if (!face_settings.count(primary_id)) {
+                face_settings[primary_id] = default_settings;
+            }
+            EyeSettings = face_settings[primary_id];
+        }
 
-        Point left_pupil, right_pupil;
-        Rect left_eye, right_eye;
+        Mat &frame = job.frame;
+        vector<Rect> &faces = job.faces;
+        Point &left_pupil = job.left_pupil, &right_pupil = job.right_pupil;
+        Rect &left_eye = job.left_eye, &right_eye = job.right_eye;
+        LocatorStats &left_stats = job.left_stats, &right_stats = job.right_stats;
+        render_timer.resume();
         if (faces.size() > 0) {
-            find_eyes(frame, faces[0], left_pupil, right_pupil, left_eye, right_eye);
-            display_eyes(frame, faces[0], left_pupil, right_pupil, left_eye, right_eye);
+            if (job.locator.sparseGradients || job.locator.pyramid || job.locator.fftObjective || job.locator.predictive ||
+                job.locator.darkWeight) {
+                display_eyes(frame, faces[0], left_pupil, right_pupil, left_eye, right_eye, 0, false, &left_stats, &right_stats);
+            } else {
+                display_eyes(frame, faces[0], left_pupil, right_pupil, left_eye, right_eye);
+            }
+            #if DEBUG
+            console << "voters: " << left_stats.voters << "," << right_stats.voters << endl;
+            #endif
+        }
+        for (size_t p = 1; p < job.people.size(); p++) {
+            const FacePupils &person = job.people[p];
+            Mat face_image = frame(person.face);
+            rectangle(face_image, person.left_eye, Scalar(0, 0, 255));
+            rectangle(face_image, person.right_eye, Scalar(0, 0, 255));
+            circle(face_image, person.left_pupil, 3, Scalar(0, 255, 0));
+            circle(face_image, person.right_pupil, 3, Scalar(0, 255, 0));
+            putText(frame, "Face " + to_string(person.id), person.face.tl(), FONT_HERSHEY_SIMPLEX, 0.6, Scalar(255,0,0));
         }
+        render_timer.pause();
 
         // if 'q' is tapped, exit
-        int wait_key = waitKey(8);
+        // replays take scripted keys and don't wait on the window
+        int wait_key;
+        if (headless) {
+            wait_key = key_script.keyAt(job.index);
+        } else if (source.isLive()) {
+            wait_key = waitKey(8);
+        } else {
+            wait_key = waitKey(1);
+            if (wait_key < 0) {
+                wait_key = key_script.keyAt(job.index);
+            }
+        }
         if (wait_key == 113) {
             break;
         }
@@ -560,11 +730,43 @@ int main(int argc, char* argv[]) {
             doGoogle = !doGoogle;
         }
 
-        EyeSettings.CenterPointOfEyes.x = ((right_eye.x + right_eye.width/2) + (left_eye.x + left_eye.width/2))/2;
-        EyeSettings.CenterPointOfEyes.y = ((right_eye.y + right_eye.height/2) + (left_eye.y + left_eye.height/2))/2;
+        // 'l' toggles the latency overlay, timing starts with it
+        if (wait_key == 108) {
+            showLatency = !showLatency;
+            if (showLatency) {
+                set_latency_enabled(true);
+            }
+        }
+
+        // 'v' toggles sparse gradient voting
+        if (wait_key == 118) {
+            if (threaded) {
+                LocatorSettingsSt settings = pipeline.locatorSettings();
+                settings.sparseGradients = !settings.sparseGradients;
+                pipeline.setLocatorSettings(settings);
+            } else {
+                LocatorSettings.sparseGradients = !LocatorSettings.sparseGradients;
+            }
+        }
+
+        if (threaded) {
+            droppedFrames = 0;
+            for (int s = 0; s < STAGE_COUNT; s++) {
+                droppedFrames += pipeline.dropped((PipelineStage)s);
+            }
+            putText(frame, pipeline.describe(), cvPoint(20,40), FONT_HERSHEY_SIMPLEX, 0.6, Scalar(255,0,0));
+            #if DEBUG
+            console << pipeline.describe() << endl;
+            #endif
+        }
 
-        EyeSettings.OffsetFromEyeCenter.x = EyeSettings.CenterPointOfEyes.x - (right_pupil.x + left_pupil.x)/2;
-        EyeSettings.OffsetFromEyeCenter.y = EyeSettings.CenterPointOfEyes.y - (right_pupil.y + left_pupil.y)/2;
+        if (scheduler.enabled()) {
+            char text[80];
+            snprintf(text, sizeof(text), "Quality level %d (%.1f of %.1f ms)", job.quality, scheduler.averageMs(), budget_ms);
+            putText(frame, text, cvPoint(20,70), FONT_HERSHEY_SIMPLEX, 0.6, Scalar(255,0,0));
+        }
+
+        update_eye_offset(EyeSettings, left_eye, right_eye, left_pupil, right_pupil);
 
         ListenForCalibrate(wait_key, frame);
 
@@ -586,25 +788,20 @@ int main(int argc, char* argv[]) {
             }
         }
 
+        Point gaze(-1, -1);
+        Point target(-1, -1);
         if (!doCalibrate) {
-            double pupilOffsetfromLeft = EyeSettings.OffsetFromEyeCenter.x+EyeSettings.eyeLeftMax;
-            double pupilOffsetfromBottom = EyeSettings.OffsetFromEyeCenter.y+EyeSettings.eyeBottomMax;
-
-            double percentageWidth = pupilOffsetfromLeft / (double)(EyeSettings.eyeLeftMax + EyeSettings.eyeRightMax);
-            if(percentageWidth < 0){
-                percentageWidth = 0;
-            }else if(percentageWidth > 1){
-                percentageWidth = 1;
-            }
-            double percentageHeight = pupilOffsetfromBottom / (double)(EyeSettings.eyeTopMax + EyeSettings.eyeBottomMax);
-            if(percentageHeight < 0){
-                percentageHeight = 0;
-            }else if(percentageHeight > 1){
-                percentageHeight = 1;
-            }
+            int64_t gaze_start = latency_start();
+            Point2d fraction = gaze_fraction(EyeSettings);
+            double percentageWidth = fraction.x, percentageHeight = fraction.y;
+            gaze = gaze_point(EyeSettings, frame.size());
+            latency_record(LATENCY_GAZE, gaze_start);
+            render_timer.resume();
 
             #if DEBUG
-            cout << "xmax: " << (EyeSettings.eyeLeftMax + EyeSettings.eyeRightMax) << " cur: " << pupilOffsetfromLeft << " = "<< percentageWidth << " , "
+            double pupilOffsetfromLeft = EyeSettings.OffsetFromEyeCenter.x+EyeSettings.eyeLeftMax;
+            double pupilOffsetfromBottom = EyeSettings.OffsetFromEyeCenter.y+EyeSettings.eyeBottomMax;
+            console << "xmax: " << (EyeSettings.eyeLeftMax + EyeSettings.eyeRightMax) << " cur: " << pupilOffsetfromLeft << " = "<< percentageWidth << " , "
                  << "ymax: " << (EyeSettings.eyeTopMax + EyeSettings.eyeBottomMax) << " cur: " << pupilOffsetfromBottom << " = "<< percentageHeight << endl;
             //draw expected position on screen from pupils
             circle(frame, Point(
@@ -634,49 +831,108 @@ int main(int argc, char* argv[]) {
             //imwrite(("test/test"+std::to_string(EyeSettings.count)+".png"), shape_screen);
             //imwrite(("test/testcolor"+std::to_string(EyeSettings.count)+".png"), frame);
             EyeSettings.count++;
-            imshow("window", frame);
+            show_window(frame);
             #else
             if (doGoogle) {
                 display_googley_eyes(frame, faces[0], left_pupil, right_pupil, left_eye, right_eye);
-                imshow("window", frame);
+                show_window(frame);
             } else {
-                display_shapes_on_screen(shape_screen, region_centers,
-                                         Point(frame.cols * percentageWidth, frame.rows * (1 - percentageHeight)),
-                                         (faces.size() > 0 ? 2 : 1));
-                imshow("window", shape_screen);
+                Point guess(frame.cols * percentageWidth, frame.rows * (1 - percentageHeight));
+                display_shapes_on_screen(shape_screen, gazeTargets, guess, (faces.size() > 0 ? 2 : 1));
+                // announce a target once the gaze has rested on it long enough
+                int selected = dwellTracker.update(faces.size() > 0 ? gazeTargets.nearest(guess) : -1,
+                                                   getTickCount() * 1000.0 / getTickFrequency());
+                if (selected >= 0) {
+                    cerr << "Selected target " << selected << " " << region_centers[selected] << endl;
+                }
+                show_window(shape_screen);
             }
 
             #endif
+            render_timer.pause();
 
             #if CLUSTERING
             //looking at new point, start recording data 'z'
             if (wait_key == 122 && currentShape<(int)region_centers.size()) {
                 record=1;
                 currentShape++;
-                cout << "Record data for grid area " << currentShape << endl;
+                console << "Record data for grid area " << currentShape << endl;
             }
             if(record < 20 && record > 0){
-                //actual sphere looking at, sphere it thinks we're looking at, exact screen point thinks looking at
-                cout << region_centers[currentShape] << ","
-                << closestPoint(region_centers, Point(frame.cols*percentageWidth, frame.rows*(1-percentageHeight))) << ","
-                <<  Point(frame.cols*percentageWidth, frame.rows*(1-percentageHeight)) << endl;
+                // the gaze log carries the target with the sample, otherwise print
+                // actual sphere looking at, sphere it thinks we're looking at, exact screen point thinks looking at
+                target = region_centers[currentShape];
+                if (!gaze_log.isOpen()) {
+                    console << region_centers[currentShape] << ","
+                    << region_centers[gazeTargets.nearest(Point(frame.cols*percentageWidth, frame.rows*(1-percentageHeight)))] << ","
+                    <<  Point(frame.cols*percentageWidth, frame.rows*(1-percentageHeight)) << "\n";
+                }
                 circle(shape_screen, region_centers[currentShape], 4, Scalar(0,0,0), -1);
-                imshow("window", shape_screen);
+                shapeRenderer.invalidate(Rect(region_centers[currentShape] - Point(5, 5), Size(11, 11)));
+                show_window(shape_screen);
 
                 record++;
             }
             #endif
         }
 
+        render_timer.resume();
         if(doCalibrate && DEBUG) {
-            imshow("window", frame);
+            show_window(frame);
         }
         if(doCalibrate && !DEBUG){
-            display_shapes_on_screen(shape_screen, region_centers, Point(), 0);
-            imshow("window", shape_screen);
+            display_shapes_on_screen(shape_screen, gazeTargets, Point(), 0);
+            show_window(shape_screen);
+        }
+        render_timer.pause();
+
+        if (records) {
+            write_frame_record(*records, job.index, faces, left_pupil, right_pupil, gaze, job.quality);
+        }
+        if (gaze_log.isOpen()) {
+            write_gaze_sample(gaze_log, job.index, faces, left_eye, right_eye, left_pupil, right_pupil, gaze, target);
         }
 
-        cap >> frame;
+        if (primary_id >= 0) {
+            face_settings[primary_id] = EyeSettings;
+        }
+
+        // the first frame warms the buffers up, only steady state is counted
+        if (frames > 1) {
+            loop_allocs += allocation_count() - allocs_at_start;
+        }
+
+        if (scheduler.record((getTickCount() - frame_ticks) * 1000.0 / getTickFrequency())) {
+            const QualityLevel &level = scheduler.level();
+            if (threaded) {
+                pipeline.setQuality(level);
+            } else {
+                apply_quality(level, face_tracker);
+                apply_quality(level, LocatorSettings);
+            }
+            #if DEBUG
+            console << "quality level " << level.level << " at " << scheduler.averageMs() << " ms/frame" << endl;
+            #endif
+        }
+    }
+    pipeline.stop();
+    gaze_log.close();
+
+    if (!stats_name.empty() && !write_latency_stats(stats_name, droppedFrames)) {
+        cerr << "Failed to write <" << stats_name << ">!";
+        exit(1);
+    }
+
+    if (!source.isLive()) {
+        double seconds = (getTickCount() - start_ticks) / getTickFrequency();
+        cerr << "Processed " << frames << " frames in " << seconds << "s (" << frames / seconds << " fps)" << endl;
+        if (allocation_counting() && frames > 1) {
+            cerr << "Heap allocations per frame: " << (double)loop_allocs / (frames - 1) << " in the loop";
+            if (!threaded) {
+                cerr << ", " << (double)locate_allocs / (frames - 1) << " locating pupils";
+            }
+            cerr << endl;
+        }
     }
 
     return 0;
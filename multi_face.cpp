@@ -0,0 +1,116 @@
+#include "multi_face.h"
+#include "constants.h"
+#include <algorithm>
+
+using namespace std;
+using namespace cv;
+
+static double overlap(const Rect &a, const Rect &b) {
+    double intersection = (a & b).area();
+    double combined = a.area() + b.area() - intersection;
+    return combined > 0 ? intersection / combined : 0.0;
+}
+
+FaceIdentities::FaceIdentities() : next_id(0) {
+}
+
+vector<int> FaceIdentities::update(const vector<Rect> &faces) {
+    vector<int> ids(faces.size(), -1);
+    vector<bool> matched(tracks.size(), false);
+
+    // greedy, best overlapping pair first
+    while (true) {
+        double best = kFaceMatchOverlap;
+        int best_face = -1, best_track = -1;
+        for (size_t f = 0; f < faces.size(); f++) {
+            if (ids[f] >= 0) {
+                continue;
+            }
+            for (size_t t = 0; t < tracks.size(); t++) {
+                double o = matched[t] ? 0.0 : overlap(faces[f], tracks[t].face);
+                if (o > best) {
+                    best = o;
+                    best_face = f;
+                    best_track = t;
+                }
+            }
+        }
+        if (best_face < 0) {
+            break;
+        }
+        ids[best_face] = tracks[best_track].id;
+        tracks[best_track].face = faces[best_face];
+        tracks[best_track].missed = 0;
+        matched[best_track] = true;
+    }
+
+    for (size_t t = 0; t < tracks.size(); t++) {
+        if (!matched[t]) {
+            tracks[t].missed++;
+        }
+    }
+    tracks.erase(remove_if(tracks.begin(), tracks.end(), [](const Track &t) { return t.missed > kFaceMaxMissed; }),
+                 tracks.end());
+
+    for (size_t f = 0; f < faces.size(); f++) {
+        if (ids[f] < 0) {
+            Track track = {next_id++, faces[f], 0};
+            tracks.push_back(track);
+            ids[f] = track.id;
+        }
+    }
+    return ids;
+}
+
+/*
+ * returns the pupils of every face, each eye of each face is one pool task
+ *
+ * color_image: image of the whole frame
+ * faces: dimensions of the faces in color_image
+ * ids: id of each face
+ * filters: optional, pupil filters by id
+ */
+vector<FacePupils> find_eyes_batch(const Mat &color_image, const vector<Rect> &faces, const vector<int> &ids,
+                                   ThreadPool &pool, map<int, EyeFilters> *filters) {
+    vector<FacePupils> results(faces.size());
+    // looked up up front, the map isn't touched from the pool
+    vector<EyeFilters *> face_filters(faces.size(), NULL);
+    for (size_t i = 0; i < faces.size(); i++) {
+        results[i].id = ids[i];
+        results[i].face = faces[i];
+        eye_regions(faces[i], results[i].left_eye, results[i].right_eye);
+        if (filters) {
+            face_filters[i] = &(*filters)[ids[i]];
+        }
+    }
+
+    pool.parallel_for(2 * faces.size(), [&](int task) {
+        FacePupils &r = results[task / 2];
+        EyeFilters *f = face_filters[task / 2];
+        Mat face_image = color_image(r.face);
+        if (task % 2 == 0) {
+            r.left_pupil = find_centers(face_image, r.left_eye, &r.left_stats, f ? &f->left : NULL) + r.left_eye.tl();
+        } else {
+            r.right_pupil = find_centers(face_image, r.right_eye, &r.right_stats, f ? &f->right : NULL) + r.right_eye.tl();
+        }
+    });
+
+    sort(results.begin(), results.end(), [](const FacePupils &a, const FacePupils &b) { return a.id < b.id; });
+    return results;
+}
+
+MultiFaceLocator::MultiFaceLocator(ThreadPool &pool) : pool(pool) {
+}
+
+vector<FacePupils> MultiFaceLocator::locate(const Mat &color_image, const vector<Rect> &faces) {
+    vector<int> ids = identities.update(faces);
+    // a face missing for a frame starts its pupils over when it comes back
+    for (map<int, EyeFilters>::iterator it = filters.begin(); it != filters.end();) {
+        if (find(ids.begin(), ids.end(), it->first) == ids.end()) {
+            it = filters.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return find_eyes_batch(color_image, faces, ids, pool, &filters);
+}
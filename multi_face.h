@@ -0,0 +1,66 @@
+#ifndef MULTI_FACE_H
+#define MULTI_FACE_H
+
+#include <map>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include "eye_center.h"
+#include "thread_pool.h"
+
+/*
+ * Pupils of one face, regions and pupils relative to the face like find_eyes
+ */
+typedef struct {
+    int id = -1;
+    cv::Rect face;
+    cv::Point left_pupil, right_pupil;
+    cv::Rect left_eye, right_eye;
+    LocatorStats left_stats, right_stats;
+} FacePupils;
+
+/*
+ * Stable ids for faces across frames, matched on overlap with the previous
+ * frame's faces and forgotten after kFaceMaxMissed frames without a match
+ */
+class FaceIdentities {
+public:
+    FaceIdentities();
+
+    // one id per face, in the same order
+    std::vector<int> update(const std::vector<cv::Rect> &faces);
+
+private:
+    typedef struct {
+        int id;
+        cv::Rect face;
+        int missed;
+    } Track;
+
+    std::vector<Track> tracks;
+    int next_id;
+};
+
+/*
+ * Finds the pupils of every face in a frame, with both eyes of all faces
+ * scheduled on a thread pool
+ */
+class MultiFaceLocator {
+public:
+    explicit MultiFaceLocator(ThreadPool &pool);
+
+    // results ordered by id, oldest face first
+    std::vector<FacePupils> locate(const cv::Mat &color_image, const std::vector<cv::Rect> &faces);
+
+private:
+    ThreadPool &pool;
+    FaceIdentities identities;
+    // pupil filters of the faces seen last frame, by id
+    std::map<int, EyeFilters> filters;
+};
+
+// filters: optional, by id, entries are added for new ids
+std::vector<FacePupils> find_eyes_batch(const cv::Mat &color_image, const std::vector<cv::Rect> &faces,
+                                        const std::vector<int> &ids, ThreadPool &pool,
+                                        std::map<int, EyeFilters> *filters = NULL);
+
+#endif
@@ -0,0 +1,220 @@
+#include "pipeline.h"
+#include "latency.h"
+#include <sstream>
+#include "opencv2/imgproc/imgproc.hpp"
+
+using namespace std;
+using namespace cv;
+
+void detect_faces(FaceTracker &face_tracker, FrameJob &job) {
+    // grey frames are detected in place, gray_image never points at them so
+    // a later colour frame can't be converted into the caller's buffer
+    const Mat *gray = &job.frame;
+    if (job.frame.channels() > 1) {
+        LatencyTimer timer(LATENCY_GRAY);
+        cvtColor(job.frame, job.gray_image, COLOR_BGRA2GRAY);
+        gray = &job.gray_image;
+    }
+    LatencyTimer timer(LATENCY_DETECT);
+    face_tracker.detect(*gray, job.faces);
+}
+
+void locate_pupils(FrameJob &job, MultiFaceLocator *multi_face, EyeFilters *filters) {
+    // jobs are recycled through the queues, clear the last frame's results
+    job.left_pupil = job.right_pupil = Point();
+    job.left_eye = job.right_eye = Rect();
+    job.left_stats = job.right_stats = LocatorStats();
+    job.locator = LocatorSettings;
+    job.people.clear();
+    if (multi_face) {
+        job.people = multi_face->locate(job.frame, job.faces);
+        job.faces.clear();
+        for (const FacePupils &person : job.people) {
+            job.faces.push_back(person.face);
+        }
+        if (job.people.size() > 0) {
+            const FacePupils &primary = job.people[0];
+            job.left_pupil = primary.left_pupil;
+            job.right_pupil = primary.right_pupil;
+            job.left_eye = primary.left_eye;
+            job.right_eye = primary.right_eye;
+            job.left_stats = primary.left_stats;
+            job.right_stats = primary.right_stats;
+        }
+    } else if (job.faces.size() > 0) {
+        find_eyes(job.frame, job.faces[0], job.left_pupil, job.right_pupil, job.left_eye, job.right_eye,
+                  &job.left_stats, &job.right_stats, filters);
+    } else if (filters) {
+        filters->left.reset();
+        filters->right.reset();
+    }
+}
+
+static const char *stage_names[STAGE_COUNT] = {"capture", "gray", "detect", "locate"};
+
+Pipeline::Pipeline(FrameSource &source, FaceTracker &face_tracker, QueuePolicy policy, MultiFaceLocator *multi_face)
+        : source(source), face_tracker(face_tracker), policy(policy), multi_face(multi_face), running(false) {
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        drops[i] = 0;
+    }
+    locator_settings.set(LocatorSettings);
+    quality.set(quality_level(0));
+}
+
+Pipeline::~Pipeline() {
+    stop();
+}
+
+void Pipeline::start() {
+    running = true;
+    threads.push_back(thread(&Pipeline::capture_stage, this));
+    threads.push_back(thread(&Pipeline::gray_stage, this));
+    threads.push_back(thread(&Pipeline::detect_stage, this));
+    threads.push_back(thread(&Pipeline::locate_stage, this));
+}
+
+void Pipeline::stop() {
+    running = false;
+    for (thread &t : threads) {
+        t.join();
+    }
+    threads.clear();
+}
+
+/*
+ * Hands job to the next stage, an empty frame marks the end of the input
+ * and is never dropped
+ */
+bool Pipeline::send(PipelineStage stage, FrameJob &job) {
+    bool end_of_input = job.frame.empty();
+    while (running) {
+        if (queues[stage].push(job)) {
+            return true;
+        }
+        if (policy != QUEUE_BLOCK && !end_of_input) {
+            drops[stage].fetch_add(1, memory_order_relaxed);
+            return true;
+        }
+        this_thread::yield();
+    }
+    return false;
+}
+
+/*
+ * Waits for the next job from stage, with QUEUE_LATEST older queued jobs
+ * are skipped
+ */
+bool Pipeline::receive(PipelineStage stage, FrameJob &job) {
+    while (running) {
+        if (queues[stage].pop(job)) {
+            if (policy == QUEUE_LATEST) {
+                while (!job.frame.empty() && queues[stage].pop(job)) {
+                    drops[stage].fetch_add(1, memory_order_relaxed);
+                }
+            }
+            return true;
+        }
+        this_thread::yield();
+    }
+    return false;
+}
+
+void Pipeline::capture_stage() {
+    while (running) {
+        FrameJob job;
+        int64_t start = latency_start();
+        bool more = source.read(job.frame);
+        latency_record(LATENCY_CAPTURE, start);
+        job.index = source.frameIndex();
+        if (!send(STAGE_CAPTURE, job) || !more) {
+            return;
+        }
+    }
+}
+
+void Pipeline::gray_stage() {
+    FrameJob job;
+    while (receive(STAGE_CAPTURE, job)) {
+        bool more = !job.frame.empty();
+        // luminance frames go on to detection as they are
+        if (more && job.frame.channels() > 1) {
+            LatencyTimer timer(LATENCY_GRAY);
+            cvtColor(job.frame, job.gray_image, COLOR_BGRA2GRAY);
+        }
+        if (!send(STAGE_GRAY, job) || !more) {
+            return;
+        }
+    }
+}
+
+void Pipeline::detect_stage() {
+    unsigned seen_quality = 0;
+    QualityLevel level;
+    FrameJob job;
+    while (receive(STAGE_GRAY, job)) {
+        bool more = !job.frame.empty();
+        if (more) {
+            // only this thread touches the face tracker while the pipeline runs
+            if (quality.refresh(level, seen_quality)) {
+                apply_quality(level, face_tracker);
+            }
+            LatencyTimer timer(LATENCY_DETECT);
+            face_tracker.detect(job.frame.channels() > 1 ? job.gray_image : job.frame, job.faces);
+        }
+        if (!send(STAGE_DETECT, job) || !more) {
+            return;
+        }
+    }
+}
+
+void Pipeline::locate_stage() {
+    unsigned seen_version = 0, seen_quality = 0;
+    QualityLevel level;
+    FrameJob job;
+    while (receive(STAGE_DETECT, job)) {
+        bool more = !job.frame.empty();
+        if (more) {
+            // only this thread reads LocatorSettings while the pipeline runs,
+            // the quality level overrides what it covers
+            bool changed = locator_settings.refresh(LocatorSettings, seen_version);
+            if (quality.refresh(level, seen_quality) || changed) {
+                apply_quality(level, LocatorSettings);
+            }
+            job.quality = level.level;
+            locate_pupils(job, multi_face, &filters);
+        }
+        if (!send(STAGE_LOCATE, job) || !more) {
+            return;
+        }
+    }
+}
+
+bool Pipeline::pop(FrameJob &job) {
+    return receive(STAGE_LOCATE, job) && !job.frame.empty();
+}
+
+void Pipeline::setLocatorSettings(const LocatorSettingsSt &settings) {
+    locator_settings.set(settings);
+}
+
+void Pipeline::setQuality(const QualityLevel &level) {
+    quality.set(level);
+}
+
+int Pipeline::depth(PipelineStage stage) const {
+    return queues[stage].depth();
+}
+
+long Pipeline::dropped(PipelineStage stage) const {
+    return drops[stage].load(memory_order_relaxed);
+}
+
+string Pipeline::describe() const {
+    stringstream ss;
+    ss << "Queues:";
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        ss << " " << stage_names[i] << " " << depth((PipelineStage)i) << "/" << kPipelineQueueSize
+           << " (" << dropped((PipelineStage)i) << " dropped)";
+    }
+    return ss.str();
+}
@@ -0,0 +1,194 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include "eye_center.h"
+#include "replay.h"
+#include "face_tracker.h"
+#include "multi_face.h"
+#include "quality.h"
+
+/*
+ * Everything one frame carries from capture to render
+ */
+typedef struct {
+    int index = -1;
+    cv::Mat frame;
+    cv::Mat gray_image;
+    std::vector<cv::Rect> faces;
+    cv::Point left_pupil, right_pupil;
+    cv::Rect left_eye, right_eye;
+    LocatorStats left_stats, right_stats;
+    // every face in multi face mode, faces[0] and the pupils above are people[0]
+    std::vector<FacePupils> people;
+    // locator settings the pupils were found with
+    LocatorSettingsSt locator;
+    // quality level the frame was processed at
+    int quality = 0;
+} FrameJob;
+
+// stage bodies, shared by the inline loop and the pipeline threads
+void detect_faces(FaceTracker &face_tracker, FrameJob &job);
+// filters: pupil filters of the single face, reset when it is lost
+void locate_pupils(FrameJob &job, MultiFaceLocator *multi_face = NULL, EyeFilters *filters = NULL);
+
+/*
+ * What a stage does when the queue it feeds is full
+ * QUEUE_BLOCK waits for room (replays, every frame is processed)
+ * QUEUE_DROP_NEWEST discards the frame being pushed
+ * QUEUE_LATEST lets the consumer skip straight to the newest frame
+ */
+enum QueuePolicy {
+    QUEUE_BLOCK,
+    QUEUE_DROP_NEWEST,
+    QUEUE_LATEST
+};
+
+/*
+ * Lock-free single producer, single consumer ring of N - 1 slots
+ */
+template <typename T, int N>
+class SpscRing {
+public:
+    SpscRing() : head(0), tail(0) {}
+
+    bool push(T &value) {
+        int h = head.load(std::memory_order_relaxed);
+        int next = (h + 1) % N;
+        if (next == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        std::swap(slots[h], value);
+        head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &value) {
+        int t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        std::swap(slots[t], value);
+        tail.store((t + 1) % N, std::memory_order_release);
+        return true;
+    }
+
+    int depth() const {
+        int d = head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+        return d < 0 ? d + N : d;
+    }
+
+private:
+    T slots[N];
+    std::atomic<int> head, tail;
+};
+
+/*
+ * Settings edited by one stage and read by another, readers only take the
+ * lock when the version has moved
+ */
+template <typename T>
+class SharedState {
+public:
+    SharedState() : version(0) {}
+
+    void set(const T &v) {
+        std::lock_guard<std::mutex> lock(mutex);
+        value = v;
+        version.fetch_add(1, std::memory_order_release);
+    }
+
+    T get() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return value;
+    }
+
+    // copies into dst if changed since seen_version, returns whether it did
+    bool refresh(T &dst, unsigned &seen_version) const {
+        if (version.load(std::memory_order_acquire) == seen_version) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        dst = value;
+        seen_version = version.load(std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    mutable std::mutex mutex;
+    T value;
+    std::atomic<unsigned> version;
+};
+
+const int kPipelineQueueSize = 4;
+
+enum PipelineStage {
+    STAGE_CAPTURE,
+    STAGE_GRAY,
+    STAGE_DETECT,
+    STAGE_LOCATE,
+    STAGE_COUNT
+};
+
+/*
+ * capture -> gray -> detect -> locate threads feeding the render stage,
+ * which pops finished frames on the main thread (the only one allowed to
+ * touch the window and EyeSettings)
+ *
+ * The locate thread owns the LocatorSettings global while running, the
+ * render stage hands it changes through setLocatorSettings() and quality
+ * changes through setQuality()
+ */
+class Pipeline {
+public:
+    Pipeline(FrameSource &source, FaceTracker &face_tracker, QueuePolicy policy, MultiFaceLocator *multi_face = NULL);
+    ~Pipeline();
+
+    void start();
+    void stop();
+
+    // next located frame, false once the source has run dry
+    bool pop(FrameJob &job);
+
+    void setLocatorSettings(const LocatorSettingsSt &settings);
+    LocatorSettingsSt locatorSettings() const { return locator_settings.get(); }
+    // picked up by the detect and locate stages from their next frame
+    void setQuality(const QualityLevel &level);
+
+    // frames waiting in the queue a stage feeds, and frames it dropped
+    int depth(PipelineStage stage) const;
+    long dropped(PipelineStage stage) const;
+    std::string describe() const;
+
+private:
+    typedef SpscRing<FrameJob, kPipelineQueueSize + 1> Queue;
+
+    void capture_stage();
+    void gray_stage();
+    void detect_stage();
+    void locate_stage();
+
+    bool send(PipelineStage stage, FrameJob &job);
+    bool receive(PipelineStage stage, FrameJob &job);
+
+    FrameSource &source;
+    FaceTracker &face_tracker;
+    QueuePolicy policy;
+    MultiFaceLocator *multi_face;
+
+    Queue queues[STAGE_COUNT];
+    std::atomic<long> drops[STAGE_COUNT];
+    std::atomic<bool> running;
+    std::vector<std::thread> threads;
+    SharedState<LocatorSettingsSt> locator_settings;
+    SharedState<QualityLevel> quality;
+    // owned by the locate thread
+    EyeFilters filters;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include "pupil_filter.h"
+#include "constants.h"
+#include <cmath>
+
+using namespace std;
+using namespace cv;
+
+PupilFilter::PupilFilter() {
+    reset();
+}
+
+void PupilFilter::reset() {
+    position = velocity = Point2f(0.0f, 0.0f);
+    error = kPupilMaxError;
+    frames = 0;
+}
+
+Rect PupilFilter::predict(int width) const {
+    // the velocity needs two frames before the window can be trusted
+    if (frames < 2 || error >= kPupilMaxError) {
+        return Rect();
+    }
+    Point2f predicted = position + velocity;
+    float radius = (kPupilWindowMin + kPupilWindowGain * error) * width;
+    int r = (int)ceil(radius);
+    return Rect((int)floor(predicted.x * width) - r, (int)floor(predicted.y * width) - r, 2 * r + 1, 2 * r + 1);
+}
+
+Point PupilFilter::update(Point measured, int width) {
+    Point2f z(measured.x / (float)width, measured.y / (float)width);
+    if (frames == 0) {
+        position = z;
+        velocity = Point2f(0.0f, 0.0f);
+        frames = 1;
+        return measured;
+    }
+
+    Point2f predicted = position + velocity;
+    Point2f residual = z - predicted;
+    float distance = sqrt(residual.x * residual.x + residual.y * residual.y);
+    if (distance > kPupilMaxError) {
+        // a blink or a lost eye, start over from the measurement
+        reset();
+        position = z;
+        frames = 1;
+        return measured;
+    }
+
+    position = predicted + kPupilAlpha * residual;
+    velocity = velocity + kPupilBeta * residual;
+    error += kPupilErrorRate * (distance - error);
+    frames++;
+    return Point((int)round(position.x * width), (int)round(position.y * width));
+}
@@ -0,0 +1,41 @@
+#ifndef PUPIL_FILTER_H
+#define PUPIL_FILTER_H
+
+#include <opencv2/core/core.hpp>
+
+/*
+ * Constant velocity alpha-beta filter on one pupil, in fractions of the eye
+ * region width so it is independent of how far away the face is
+ *
+ * predict() gives the candidate centers worth scoring this frame, a window
+ * around the predicted position that grows with the recent prediction
+ * error, update() folds in the measured pupil and returns the smoothed one
+ */
+class PupilFilter {
+public:
+    PupilFilter();
+
+    // candidate window on a grid width cells wide, empty to score everything
+    cv::Rect predict(int width) const;
+    // measured position in grid cells, returns the smoothed position
+    cv::Point update(cv::Point measured, int width);
+    // forget the pupil, the next frame scores the whole grid
+    void reset();
+
+    bool tracking() const { return frames > 0; }
+
+private:
+    cv::Point2f position, velocity;
+    // running mean of the prediction error
+    float error;
+    int frames;
+};
+
+/*
+ * Filters for both eyes of one face
+ */
+typedef struct {
+    PupilFilter left, right;
+} EyeFilters;
+
+#endif
@@ -0,0 +1,80 @@
+#include "quality.h"
+
+using namespace std;
+
+static QualityLevel make_level(int level, int eye_width, double scale_factor, double min_face,
+                               int full_detect_every, int process_every) {
+    QualityLevel quality;
+    quality.level = level;
+    quality.eyeWidth = eye_width;
+    quality.scaleFactor = scale_factor;
+    quality.minFace = min_face;
+    quality.fullDetectEvery = full_detect_every;
+    quality.processEvery = process_every;
+    return quality;
+}
+
+/*
+ * Cheapest savings first: a smaller eye patch and coarser cascade search,
+ * then fewer full frame detections, and skipping frames only at the end
+ */
+static const QualityLevel levels[] = {
+    make_level(0, kFastEyeWidth, 1.1, 0.0, kTrackFullDetectEvery, 1),
+    make_level(1, 40, 1.15, 0.1, kTrackFullDetectEvery, 1),
+    make_level(2, 32, 1.2, 0.15, 2 * kTrackFullDetectEvery, 1),
+    make_level(3, 32, 1.3, 0.2, 3 * kTrackFullDetectEvery, 1),
+    make_level(4, 24, 1.3, 0.2, 3 * kTrackFullDetectEvery, 2),
+    make_level(5, 24, 1.4, 0.25, 4 * kTrackFullDetectEvery, 3),
+};
+
+int quality_level_count() {
+    return sizeof(levels) / sizeof(levels[0]);
+}
+
+const QualityLevel &quality_level(int level) {
+    return levels[max(0, min(level, quality_level_count() - 1))];
+}
+
+void apply_quality(const QualityLevel &quality, FaceTracker &face_tracker) {
+    face_tracker.setScaleFactor(quality.scaleFactor);
+    face_tracker.setMinFace(quality.minFace);
+    face_tracker.setFullDetectEvery(quality.fullDetectEvery);
+}
+
+void apply_quality(const QualityLevel &quality, LocatorSettingsSt &locator) {
+    locator.eyeWidth = quality.eyeWidth;
+}
+
+QualityScheduler::QualityScheduler()
+        : budget_ms(0.0), level_index(0), average_ms(0.0), frames_at_level(0), frame_count(0) {
+}
+
+void QualityScheduler::setBudget(double budget) {
+    budget_ms = budget;
+    level_index = 0;
+    frames_at_level = 0;
+}
+
+bool QualityScheduler::shouldProcess() {
+    return frame_count++ % level().processEvery == 0;
+}
+
+bool QualityScheduler::record(double frame_ms) {
+    if (!enabled()) {
+        return false;
+    }
+    // each level starts its average over
+    average_ms = frames_at_level == 0 ? frame_ms : average_ms + kQualityAverageRate * (frame_ms - average_ms);
+    if (++frames_at_level < kQualityHoldFrames) {
+        return false;
+    }
+    if (average_ms > budget_ms && level_index + 1 < quality_level_count()) {
+        level_index++;
+    } else if (average_ms < budget_ms * kQualityRecoverRatio && level_index > 0) {
+        level_index--;
+    } else {
+        return false;
+    }
+    frames_at_level = 0;
+    return true;
+}
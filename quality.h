@@ -0,0 +1,59 @@
+#ifndef QUALITY_H
+#define QUALITY_H
+
+#include "constants.h"
+#include "eye_center.h"
+#include "face_tracker.h"
+
+/*
+ * How much work a frame gets, level 0 is full quality
+ */
+typedef struct {
+    int level = 0;
+    // scaled eye width for find_centers
+    int eyeWidth = kFastEyeWidth;
+    // cascade scale step and smallest face, a fraction of the frame's shorter side
+    double scaleFactor = 1.1;
+    double minFace = 0.0;
+    // frames between full frame face detections while tracking
+    int fullDetectEvery = kTrackFullDetectEvery;
+    // only every processEvery-th frame is detected and located
+    int processEvery = 1;
+} QualityLevel;
+
+int quality_level_count();
+const QualityLevel &quality_level(int level);
+
+void apply_quality(const QualityLevel &quality, FaceTracker &face_tracker);
+void apply_quality(const QualityLevel &quality, LocatorSettingsSt &locator);
+
+/*
+ * Steps through the quality levels to keep a running average of the frame
+ * time under a budget: down a level when the average is over it, back up
+ * once it is well under, holding each level for kQualityHoldFrames frames
+ */
+class QualityScheduler {
+public:
+    QualityScheduler();
+
+    // budget_ms: 0 turns the scheduler off and keeps full quality
+    void setBudget(double budget_ms);
+    bool enabled() const { return budget_ms > 0.0; }
+
+    const QualityLevel &level() const { return quality_level(level_index); }
+    double averageMs() const { return average_ms; }
+
+    // whether the next frame is detected and located or skipped
+    bool shouldProcess();
+    // time one whole frame took, returns true if the level changed
+    bool record(double frame_ms);
+
+private:
+    double budget_ms;
+    int level_index;
+    double average_ms;
+    int frames_at_level;
+    long frame_count;
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include "replay.h"
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include "opencv2/imgproc/imgproc.hpp"
+
+using namespace std;
+using namespace cv;
+
+FrameSource::FrameSource()
+        : next_image(0), repeat(1), pass(0), frame_index(-1), live(false), luma(false), raw_format(PIXEL_GRAY) {
+}
+
+static bool is_image(const string &path) {
+    static const char *extensions[] = {".png", ".jpg", ".jpeg", ".bmp", ".pgm", ".ppm", ".tif", ".tiff"};
+    size_t dot = path.rfind('.');
+    if (dot == string::npos) {
+        return false;
+    }
+    string extension = path.substr(dot);
+    for (char &c : extension) {
+        c = tolower(c);
+    }
+    for (const char *e : extensions) {
+        if (extension == e) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FrameSource::open(const string &input_name, int repeat_count) {
+    input = input_name;
+    repeat = max(repeat_count, 1);
+    pass = 0;
+    frame_index = -1;
+    images.clear();
+    live = input.empty();
+
+    if (live) {
+        if (!cap.open(0)) {
+            return false;
+        }
+        if (luma) {
+            // raw YUYV where the backend allows it, read() copes with whatever arrives
+            cap.set(CAP_PROP_FOURCC, VideoWriter::fourcc('Y', 'U', 'Y', 'V'));
+            cap.set(CAP_PROP_CONVERT_RGB, 0);
+            capture_size = Size(cap.get(CAP_PROP_FRAME_WIDTH), cap.get(CAP_PROP_FRAME_HEIGHT));
+        }
+        return true;
+    }
+
+    if (raw_size.area() > 0) {
+        raw_file.close();
+        raw_file.clear();
+        raw_file.open(input.c_str(), ios::binary);
+        return raw_file.is_open();
+    }
+    if (list_images(input, images)) {
+        return !images.empty();
+    }
+    return cap.open(input);
+}
+
+bool list_images(const string &input, vector<String> &images) {
+    images.clear();
+    struct stat buffer;
+    bool is_dir = stat(input.c_str(), &buffer) == 0 && S_ISDIR(buffer.st_mode);
+    if (is_dir || input.find_first_of("*?") != string::npos) {
+        vector<String> matches;
+        glob(is_dir ? input + "/*" : input, matches, false);
+        for (const String &m : matches) {
+            if (is_image(m)) {
+                images.push_back(m);
+            }
+        }
+        // glob sorts, so replays are in a deterministic order
+        return true;
+    }
+    if (is_image(input)) {
+        images.push_back(input);
+        return true;
+    }
+    return false;
+}
+
+bool FrameSource::rewind() {
+    if (live || ++pass >= repeat) {
+        return false;
+    }
+    if (raw_size.area() > 0) {
+        raw_file.clear();
+        raw_file.seekg(0);
+        return true;
+    }
+    if (images.empty()) {
+        cap.release();
+        return cap.open(input);
+    }
+    next_image = 0;
+    return true;
+}
+
+/*
+ * With CAP_PROP_CONVERT_RGB off a camera hands over its YUYV bytes, as a 2
+ * channel image or a single row of bytes depending on the backend, and a
+ * backend that ignored it (or a video file) still delivers BGR
+ */
+bool FrameSource::read_capture(Mat &frame) {
+    if (!luma) {
+        return cap.read(frame) && !frame.empty();
+    }
+    if (!cap.read(raw_frame) || raw_frame.empty()) {
+        return false;
+    }
+    if (raw_frame.channels() == 1 && raw_frame.rows == 1 &&
+        raw_frame.total() == raw_frame_bytes(PIXEL_YUYV, capture_size)) {
+        raw_frame = raw_frame.reshape(2, capture_size.height);
+    }
+    if (raw_frame.channels() == 2) {
+        luma_plane(raw_frame, PIXEL_YUYV, frame);
+    } else if (raw_frame.channels() == 1) {
+        swap(frame, raw_frame);
+    } else {
+        cvtColor(raw_frame, frame, COLOR_BGRA2GRAY);
+    }
+    return true;
+}
+
+bool FrameSource::read_raw(Mat &frame) {
+    int rows, type;
+    raw_layout(raw_format, raw_size, rows, type);
+    if (luma && (raw_format == PIXEL_GRAY || raw_format == PIXEL_NV12)) {
+        // the Y plane straight into the frame, NV12's chroma is skipped over
+        if (!frame.isContinuous()) {
+            frame.release();
+        }
+        frame.create(raw_size, CV_8U);
+        if (!raw_file.read((char *)frame.data, frame.total())) {
+            return false;
+        }
+        if (raw_format == PIXEL_NV12) {
+            raw_file.seekg(raw_size.area() / 2, ios::cur);
+        }
+        return true;
+    }
+    raw_frame.create(rows, raw_size.width, type);
+    if (!raw_file.read((char *)raw_frame.data, raw_frame.total() * raw_frame.elemSize())) {
+        return false;
+    }
+    if (luma) {
+        luma_plane(raw_frame, raw_format, frame);
+    } else {
+        raw_to_bgr(raw_frame, raw_format, frame);
+    }
+    return true;
+}
+
+bool FrameSource::read(Mat &frame) {
+    while (true) {
+        if (raw_size.area() > 0) {
+            if (read_raw(frame)) {
+                break;
+            }
+        } else if (images.empty()) {
+            if (read_capture(frame)) {
+                break;
+            }
+        } else if (next_image < images.size()) {
+            frame = imread(images[next_image++], luma ? IMREAD_GRAYSCALE : IMREAD_COLOR);
+            if (!frame.empty()) {
+                break;
+            }
+            continue;
+        }
+        if (!rewind()) {
+            frame.release();
+            return false;
+        }
+    }
+    frame_index++;
+    return true;
+}
+
+static int key_code(const string &name) {
+    if (name == "space") {
+        return 32;
+    }
+    if (name.size() == 1) {
+        return name[0];
+    }
+    return -1;
+}
+
+bool KeyScript::load(const string &script) {
+    string text = script;
+    ifstream file(script.c_str());
+    if (file) {
+        stringstream contents;
+        contents << file.rdbuf();
+        text = contents.str();
+    }
+    for (char &c : text) {
+        if (c == '\n' || c == '\r') {
+            c = ',';
+        }
+    }
+
+    stringstream ss(text);
+    string entry;
+    while (getline(ss, entry, ',')) {
+        if (entry.empty()) {
+            continue;
+        }
+        size_t colon = entry.find(':');
+        if (colon == string::npos) {
+            return false;
+        }
+        int key = key_code(entry.substr(colon + 1));
+        if (key < 0) {
+            return false;
+        }
+        keys[atoi(entry.substr(0, colon).c_str())] = key;
+    }
+    return true;
+}
+
+int KeyScript::keyAt(int frame) const {
+    map<int, int>::const_iterator key = keys.find(frame);
+    return key == keys.end() ? -1 : key->second;
+}
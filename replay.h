@@ -0,0 +1,81 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include "luma.h"
+
+/*
+ * Frames from the default camera, a video file, a single image, a directory
+ * of images, a glob pattern such as "clip_*.png" or a headless raw file
+ */
+class FrameSource {
+public:
+    FrameSource();
+
+    /*
+     * Before open(): frames come out as their CV_8U luminance. The camera is
+     * asked for unconverted YUYV, images are decoded straight to grey and
+     * raw GRAY/NV12 files are read as their Y plane only.
+     */
+    void setLuma(bool enabled) { luma = enabled; }
+    // before open(): the input is consecutive size frames of format, nothing else
+    void setRawFormat(PixelFormat format, cv::Size size) { raw_format = format; raw_size = size; }
+
+    // input: empty for camera 0, repeat: passes over a recorded input
+    bool open(const std::string &input, int repeat = 1);
+    bool read(cv::Mat &frame);
+
+    bool isLive() const { return live; }
+    int frameIndex() const { return frame_index; }
+
+private:
+    bool rewind();
+    bool read_capture(cv::Mat &frame);
+    bool read_raw(cv::Mat &frame);
+
+    cv::VideoCapture cap;
+    std::vector<cv::String> images;
+    std::string input;
+    size_t next_image;
+    int repeat, pass, frame_index;
+    bool live;
+    bool luma;
+    PixelFormat raw_format;
+    cv::Size raw_size;
+    cv::Size capture_size;
+    std::ifstream raw_file;
+    // what the capture or raw file delivered, before it became the frame
+    cv::Mat raw_frame;
+};
+
+/*
+ * The images a directory, glob or single image input names, sorted
+ * returns false if input is none of those (a video or camera)
+ */
+bool list_images(const std::string &input, std::vector<cv::String> &images);
+
+/*
+ * Keypresses to inject at given frame numbers, standing in for the
+ * calibration keys when nobody is at the keyboard
+ *
+ * script: "FRAME:KEY" entries separated by commas or newlines, KEY is a
+ *         single character or "space", e.g. "10:a,20:d,30:s,40:w,50:space"
+ *         if script names a readable file its contents are used instead
+ */
+class KeyScript {
+public:
+    bool load(const std::string &script);
+    // key for frame, or -1 like waitKey when nothing was pressed
+    int keyAt(int frame) const;
+    bool empty() const { return keys.empty(); }
+
+private:
+    std::map<int, int> keys;
+};
+
+#endif
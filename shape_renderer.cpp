@@ -0,0 +1,129 @@
+#include "shape_renderer.h"
+#include "opencv2/imgproc/imgproc.hpp"
+
+using namespace std;
+using namespace cv;
+
+static const int target_radius = 20;
+static const int dot_radius = 5;
+
+/*
+ * Pixels a circle can touch, outline and rounding included
+ */
+static Rect circle_bounds(Point center, int radius) {
+    int reach = radius + 3;
+    return Rect(center.x - reach, center.y - reach, 2 * reach + 1, 2 * reach + 1);
+}
+
+static void draw_target(Mat &screen, Point center, bool highlighted) {
+    circle(screen, center, target_radius, highlighted ? Scalar(0,255,0) : Scalar(0,0,255), -1);
+    circle(screen, center, target_radius, Scalar(0,0,0), 2);
+}
+
+static Point marker_position(const Mat &screen, int marker) {
+    switch (marker) {
+        case MARKER_TOP: return Point(screen.cols / 2, 0);
+        case MARKER_RIGHT: return Point(screen.cols, screen.rows / 2);
+        case MARKER_BOTTOM: return Point(screen.cols / 2, screen.rows);
+        default: return Point(0, screen.rows / 2);
+    }
+}
+
+ShapeRenderer::ShapeRenderer() {
+    reset();
+}
+
+void ShapeRenderer::reset() {
+    screen_data = NULL;
+    shape_count = 0;
+    dirty.clear();
+}
+
+void ShapeRenderer::invalidate(const Rect &region) {
+    dirty.push_back(region);
+}
+
+void ShapeRenderer::rebuild(Mat &screen, const vector<Point> &shapes) {
+    base.create(screen.size(), screen.type());
+    base.setTo(Scalar(255,255,255));
+    for (Point s : shapes) {
+        draw_target(base, s, false);
+    }
+    base.copyTo(screen);
+
+    screen_data = screen.data;
+    shape_count = shapes.size();
+    shown_highlight = -1;
+    shown_guess_style = 0;
+    for (int m = 0; m < MARKER_COUNT; m++) {
+        shown_markers[m] = -1;
+    }
+    dirty.clear();
+}
+
+bool ShapeRenderer::is_dirty(const Rect &region) const {
+    for (const Rect &d : dirty) {
+        if ((d & region).area() > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ShapeRenderer::draw(Mat &screen, const vector<Point> &shapes, int highlighted, Point guess, int showGuess,
+                         const bool markers[MARKER_COUNT]) {
+    if (screen.data != screen_data || screen.size() != base.size() || screen.type() != base.type() ||
+        shapes.size() != shape_count) {
+        rebuild(screen, shapes);
+    }
+
+    // regions whose content goes away
+    bool highlight_moved = highlighted != shown_highlight;
+    if (highlight_moved && shown_highlight >= 0) {
+        dirty.push_back(circle_bounds(shapes[shown_highlight], target_radius));
+    }
+    bool guess_moved = showGuess != shown_guess_style || (showGuess && guess != shown_guess);
+    if (guess_moved && shown_guess_style) {
+        dirty.push_back(circle_bounds(shown_guess, dot_radius));
+    }
+    bool marker_flipped[MARKER_COUNT];
+    for (int m = 0; m < MARKER_COUNT; m++) {
+        marker_flipped[m] = shown_markers[m] != (int)markers[m];
+        if (marker_flipped[m]) {
+            dirty.push_back(circle_bounds(marker_position(screen, m), dot_radius));
+        }
+    }
+
+    Rect bounds(0, 0, screen.cols, screen.rows);
+    for (Rect &d : dirty) {
+        d &= bounds;
+        if (d.area() > 0) {
+            Mat region = screen(d);
+            base(d).copyTo(region);
+        }
+    }
+
+    // the static layer brought back plain targets, redraw what changed or
+    // sits under a restored region in the original order: highlight, guess,
+    // markers
+    if (highlighted >= 0 && (highlight_moved || is_dirty(circle_bounds(shapes[highlighted], target_radius)))) {
+        draw_target(screen, shapes[highlighted], true);
+    }
+    if (showGuess && (guess_moved || is_dirty(circle_bounds(guess, dot_radius)))) {
+        circle(screen, guess, dot_radius, showGuess == 1 ? Scalar(0,0,255) : Scalar(0,0,0), -1);
+    }
+    for (int m = 0; m < MARKER_COUNT; m++) {
+        Point p = marker_position(screen, m);
+        if (marker_flipped[m] || is_dirty(circle_bounds(p, dot_radius))) {
+            circle(screen, p, dot_radius, markers[m] ? Scalar(0,255,0) : Scalar(0,0,255), -1);
+        }
+    }
+
+    shown_highlight = highlighted;
+    shown_guess = guess;
+    shown_guess_style = showGuess;
+    for (int m = 0; m < MARKER_COUNT; m++) {
+        shown_markers[m] = markers[m];
+    }
+    dirty.clear();
+}
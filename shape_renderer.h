@@ -0,0 +1,59 @@
+#ifndef SHAPE_RENDERER_H
+#define SHAPE_RENDERER_H
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+// calibration markers on the edges of the shape screen
+enum ScreenMarker {
+    MARKER_TOP,
+    MARKER_RIGHT,
+    MARKER_BOTTOM,
+    MARKER_LEFT,
+    MARKER_COUNT
+};
+
+/*
+ * Draws the shape screen incrementally. The white background and every
+ * target live in a cached static layer, each frame only the regions that
+ * changed (the old and new guess dot, the old and new highlighted target,
+ * markers whose calibration state flipped and anything invalidated) are
+ * copied back from it and redrawn, so the cost doesn't grow with the grid
+ * or the screen size.
+ */
+class ShapeRenderer {
+public:
+    ShapeRenderer();
+
+    /*
+     * screen: drawn into, rebuilt from scratch when its size or buffer changes
+     * shapes: target centers, highlighted: index of the target to highlight
+     * guess: gaze point, showGuess: 0 hidden, 1 red (no face), 2 black
+     * markers: calibration state of each ScreenMarker
+     */
+    void draw(cv::Mat &screen, const std::vector<cv::Point> &shapes, int highlighted, cv::Point guess,
+              int showGuess, const bool markers[MARKER_COUNT]);
+
+    // something else drew over region, it is restored on the next draw
+    void invalidate(const cv::Rect &region);
+    // full redraw on the next draw, e.g. when the shapes moved
+    void reset();
+
+private:
+    void rebuild(cv::Mat &screen, const std::vector<cv::Point> &shapes);
+    bool is_dirty(const cv::Rect &region) const;
+
+    cv::Mat base;
+    const unsigned char *screen_data;
+    size_t shape_count;
+
+    // what is on screen now
+    int shown_highlight;
+    cv::Point shown_guess;
+    int shown_guess_style;
+    int shown_markers[MARKER_COUNT];
+
+    std::vector<cv::Rect> dirty;
+};
+
+#endif
@@ -0,0 +1,171 @@
+#include "synthetic_eye.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <opencv2/highgui/highgui.hpp>
+#include "opencv2/imgproc/imgproc.hpp"
+#include "constants.h"
+
+using namespace std;
+using namespace cv;
+
+// what the dataset sweeps, every combination is rendered
+static const int dataset_widths[] = {24, 50, 96, 160};
+static const double dataset_contrasts[] = {1.0, 0.6, 0.3};
+static const double dataset_noise[] = {0.0, 4.0, 12.0};
+static const bool dataset_glints[] = {false, true};
+static const double dataset_eyelids[] = {0.0, 0.25, 0.45};
+
+static const Scalar skin(150, 170, 200), sclera(225, 225, 230), iris(70, 60, 50), pupil(15, 15, 15);
+
+// 4 fractional bits, so circles land on sub-pixel centers
+static const int kDrawShift = 4;
+
+static Point fixed_point(Point2f p) {
+    return Point(cvRound(p.x * (1 << kDrawShift)), cvRound(p.y * (1 << kDrawShift)));
+}
+
+// 53 bit uniform in [0, 1) from two draws, as Python's random.random()
+static double uniform01(mt19937 &rng) {
+    double high = rng() >> 5, low = rng() >> 6;
+    return (high * 67108864.0 + low) * (1.0 / 9007199254740992.0);
+}
+
+// standard normal by Box-Muller, the sine half is dropped
+static double gaussian(mt19937 &rng) {
+    double u1 = 1.0 - uniform01(rng), u2 = uniform01(rng);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+// c moved towards target by amount
+static Scalar towards(const Scalar &c, const Scalar &target, double amount) {
+    return c + (target - c) * amount;
+}
+
+void render_synthetic_eye(const SyntheticEyeSpec &spec, mt19937 &rng, Mat &eye, Point2f &center) {
+    int width = spec.width;
+    int height = max(4, width * kEyePercentHeight / kEyePercentWidth);
+    eye.create(height, width, CV_8UC3);
+    eye.setTo(skin);
+
+    Point2f middle(width / 2.0f, height / 2.0f);
+    Size2f sclera_axes(width * 0.4f, height / 3.0f);
+    float iris_radius = max(2.0f, height / 4.0f), pupil_radius = max(1.0f, height / 9.0f);
+    ellipse(eye, Point(middle), Size(sclera_axes), 0, 0, 360, sclera, -1, LINE_AA);
+
+    // anywhere the iris still fits on the sclera sideways, less room upwards
+    float reach_x = max(0.0f, sclera_axes.width - iris_radius) * 0.8f;
+    float reach_y = max(0.0f, sclera_axes.height - iris_radius) * 0.5f;
+    float offset_x = (float)((2.0 * uniform01(rng) - 1.0) * reach_x);
+    float offset_y = (float)((2.0 * uniform01(rng) - 1.0) * reach_y);
+    center = Point2f(middle.x + offset_x, middle.y + offset_y);
+    circle(eye, fixed_point(center), cvRound(iris_radius * (1 << kDrawShift)),
+           towards(sclera, iris, spec.contrast), -1, LINE_AA, kDrawShift);
+    circle(eye, fixed_point(center), cvRound(pupil_radius * (1 << kDrawShift)),
+           towards(sclera, pupil, spec.contrast), -1, LINE_AA, kDrawShift);
+
+    if (spec.glint) {
+        Point2f offset(pupil_radius * 0.6f, -pupil_radius * 0.6f);
+        circle(eye, fixed_point(center + offset), cvRound(max(0.5f, pupil_radius / 2) * (1 << kDrawShift)),
+               Scalar::all(255), -1, LINE_AA, kDrawShift);
+    }
+
+    // the upper lid is skin down to its edge, with a line of lashes along it
+    if (spec.eyelid > 0.0) {
+        int edge = cvRound(center.y - iris_radius + spec.eyelid * 2 * iris_radius);
+        if (edge > 0) {
+            rectangle(eye, Rect(0, 0, width, min(edge, height)), skin, -1);
+            line(eye, Point(0, edge), Point(width - 1, edge), Scalar(40, 40, 40), max(1, height / 20));
+        }
+    }
+
+    // camera optics, then sensor noise
+    GaussianBlur(eye, eye, Size(3, 3), 0, 0);
+    if (spec.noise > 0.0) {
+        for (int y = 0; y < height; y++) {
+            unsigned char *row = eye.ptr<unsigned char>(y);
+            for (int i = 0; i < width * 3; i++) {
+                row[i] = saturate_cast<uchar>((float)row[i] + (float)(spec.noise * gaussian(rng)));
+            }
+        }
+    }
+}
+
+void synthetic_eye_dataset(int samples, uint64_t seed, vector<SyntheticEye> &eyes) {
+    mt19937 rng((uint32_t)seed);
+    eyes.clear();
+    for (int width : dataset_widths) {
+        for (double contrast : dataset_contrasts) {
+            for (double noise : dataset_noise) {
+                for (bool glint : dataset_glints) {
+                    for (double eyelid : dataset_eyelids) {
+                        for (int s = 0; s < samples; s++) {
+                            SyntheticEye eye;
+                            eye.spec.width = width;
+                            eye.spec.contrast = contrast;
+                            eye.spec.noise = noise;
+                            eye.spec.glint = glint;
+                            eye.spec.eyelid = eyelid;
+                            char name[32];
+                            snprintf(name, sizeof(name), "eye_%05d.png", (int)eyes.size());
+                            eye.name = name;
+                            render_synthetic_eye(eye.spec, rng, eye.image, eye.center);
+                            eyes.push_back(eye);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool write_synthetic_eyes(const string &dir, const vector<SyntheticEye> &eyes) {
+    mkdir(dir.c_str(), 0755);
+    ofstream truth((dir + "/truth.csv").c_str());
+    if (!truth) {
+        return false;
+    }
+    truth << "file,center_x,center_y,width,contrast,noise,glint,eyelid\n";
+    for (const SyntheticEye &eye : eyes) {
+        if (!imwrite(dir + "/" + eye.name, eye.image)) {
+            return false;
+        }
+        truth << eye.name << "," << eye.center.x << "," << eye.center.y << "," << eye.spec.width << ","
+              << eye.spec.contrast << "," << eye.spec.noise << "," << (eye.spec.glint ? 1 : 0) << ","
+              << eye.spec.eyelid << "\n";
+    }
+    return (bool)truth;
+}
+
+bool read_synthetic_eyes(const string &dir, vector<SyntheticEye> &eyes) {
+    ifstream truth((dir + "/truth.csv").c_str());
+    if (!truth) {
+        return false;
+    }
+    eyes.clear();
+    string line;
+    getline(truth, line);
+    while (getline(truth, line)) {
+        if (line.find_first_not_of(" \t\r") == string::npos) {
+            continue;
+        }
+        replace(line.begin(), line.end(), ',', ' ');
+        stringstream ss(line);
+        SyntheticEye eye;
+        int glint;
+        if (!(ss >> eye.name >> eye.center.x >> eye.center.y >> eye.spec.width >> eye.spec.contrast
+                 >> eye.spec.noise >> glint >> eye.spec.eyelid)) {
+            return false;
+        }
+        eye.spec.glint = glint != 0;
+        eye.image = imread(dir + "/" + eye.name);
+        if (eye.image.empty()) {
+            return false;
+        }
+        eyes.push_back(eye);
+    }
+    return true;
+}
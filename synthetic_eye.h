@@ -0,0 +1,60 @@
+#ifndef SYNTHETIC_EYE_H
+#define SYNTHETIC_EYE_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+/*
+ * How one synthetic eye patch is drawn
+ */
+typedef struct {
+    // patch width, the height follows the eye region proportions
+    int width = 50;
+    // how far the iris and pupil are darkened from the sclera, 1 is fully
+    double contrast = 1.0;
+    // standard deviation of the added sensor noise, in grey levels
+    double noise = 0.0;
+    // specular highlight on the pupil
+    bool glint = false;
+    // fraction of the iris the upper eyelid covers
+    double eyelid = 0.0;
+} SyntheticEyeSpec;
+
+/*
+ * A rendered patch and where its pupil really is
+ */
+typedef struct {
+    std::string name;
+    SyntheticEyeSpec spec;
+    cv::Mat image;
+    // pupil center in patch pixels, sub-pixel
+    cv::Point2f center;
+} SyntheticEye;
+
+/*
+ * Draws a BGR eye patch with the pupil at a random position on the sclera
+ * rng: positions and noise are drawn from it with our own uniform and
+ *      Box-Muller steps, so the patches don't depend on OpenCV's RNG
+ * eye: receives the patch
+ * center: receives the true pupil center
+ */
+void render_synthetic_eye(const SyntheticEyeSpec &spec, std::mt19937 &rng, cv::Mat &eye, cv::Point2f &center);
+
+/*
+ * samples patches for every combination of the dataset's sizes, contrasts,
+ * noise levels, glints and eyelids, the same seed (its low 32 bits) gives
+ * the same patches
+ */
+void synthetic_eye_dataset(int samples, uint64_t seed, std::vector<SyntheticEye> &eyes);
+
+/*
+ * A dataset directory holds one PNG per patch and truth.csv, which lists
+ * each patch's file, true center and spec
+ */
+bool write_synthetic_eyes(const std::string &dir, const std::vector<SyntheticEye> &eyes);
+bool read_synthetic_eyes(const std::string &dir, std::vector<SyntheticEye> &eyes);
+
+#endif
@@ -0,0 +1,161 @@
+#include "thread_pool.h"
+#include <atomic>
+#include <deque>
+#include <memory>
+
+using namespace std;
+
+ThreadPool::ThreadPool(int threads) : stopping(false) {
+    if (threads <= 0) {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+    for (int i = 0; i < threads; i++) {
+        workers.push_back(thread(&ThreadPool::worker_loop, this));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    task_ready.notify_all();
+    for (thread &t : workers) {
+        t.join();
+    }
+}
+
+void ThreadPool::submit(const function<void()> &task) {
+    {
+        lock_guard<std::mutex> lock(queue_mutex);
+        tasks.push_back(task);
+    }
+    task_ready.notify_one();
+}
+
+void ThreadPool::worker_loop() {
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock<std::mutex> lock(queue_mutex);
+            task_ready.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            task = tasks.front();
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+/*
+ * Indices are handed out through a shared counter, so a slow index never
+ * holds up the others and the caller works instead of idling
+ */
+void ThreadPool::parallel_for(int count, const function<void(int)> &task) {
+    if (count <= 0) {
+        return;
+    }
+    if (count == 1) {
+        task(0);
+        return;
+    }
+
+    struct Batch {
+        atomic<int> next;
+        atomic<int> done;
+        std::mutex mutex;
+        condition_variable finished;
+    };
+    shared_ptr<Batch> batch = make_shared<Batch>();
+    batch->next = 0;
+    batch->done = 0;
+
+    function<void()> runner = [batch, count, &task]() {
+        int i;
+        while ((i = batch->next.fetch_add(1)) < count) {
+            task(i);
+            if (batch->done.fetch_add(1) + 1 == count) {
+                lock_guard<std::mutex> lock(batch->mutex);
+                batch->finished.notify_all();
+            }
+        }
+    };
+
+    int helpers = min(count - 1, size());
+    for (int i = 0; i < helpers; i++) {
+        submit(runner);
+    }
+    runner();
+
+    unique_lock<std::mutex> lock(batch->mutex);
+    batch->finished.wait(lock, [&]() { return batch->done.load() == count; });
+}
+
+/*
+ * Owners take their block front to back, so a worker reading a video
+ * decodes consecutive segments, thieves take from the back where the owner
+ * is furthest away
+ */
+void ThreadPool::work_stealing_for(int count, const function<void(int, int)> &task) {
+    if (count <= 0) {
+        return;
+    }
+    int runners = min(count, size() + 1);
+
+    struct Block {
+        std::mutex mutex;
+        deque<int> indices;
+    };
+    struct Batch {
+        vector<Block> blocks;
+        atomic<int> done;
+        std::mutex mutex;
+        condition_variable finished;
+        explicit Batch(int n) : blocks(n), done(0) {}
+    };
+    shared_ptr<Batch> batch = make_shared<Batch>(runners);
+    for (int w = 0; w < runners; w++) {
+        for (int i = (long)count * w / runners; i < (long)count * (w + 1) / runners; i++) {
+            batch->blocks[w].indices.push_back(i);
+        }
+    }
+
+    auto take = [batch, runners](int worker, int &index) {
+        for (int k = 0; k < runners; k++) {
+            Block &block = batch->blocks[(worker + k) % runners];
+            lock_guard<std::mutex> lock(block.mutex);
+            if (!block.indices.empty()) {
+                if (k == 0) {
+                    index = block.indices.front();
+                    block.indices.pop_front();
+                } else {
+                    index = block.indices.back();
+                    block.indices.pop_back();
+                }
+                return true;
+            }
+        }
+        return false;
+    };
+
+    auto runner = [batch, count, take, &task](int worker) {
+        int i;
+        while (take(worker, i)) {
+            task(i, worker);
+            if (batch->done.fetch_add(1) + 1 == count) {
+                lock_guard<std::mutex> lock(batch->mutex);
+                batch->finished.notify_all();
+            }
+        }
+    };
+
+    for (int w = 1; w < runners; w++) {
+        submit([runner, w]() { runner(w); });
+    }
+    runner(0);
+
+    unique_lock<std::mutex> lock(batch->mutex);
+    batch->finished.wait(lock, [&]() { return batch->done.load() == count; });
+}
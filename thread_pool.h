@@ -0,0 +1,49 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed set of worker threads fed from a shared task queue
+ */
+class ThreadPool {
+public:
+    // threads: 0 uses one worker per hardware thread
+    explicit ThreadPool(int threads = 0);
+    ~ThreadPool();
+
+    int size() const { return (int)workers.size(); }
+
+    void submit(const std::function<void()> &task);
+
+    /*
+     * Runs task(0..count-1) on the workers and the calling thread, returns
+     * once every index is done
+     */
+    void parallel_for(int count, const std::function<void(int)> &task);
+
+    /*
+     * Runs task(index, worker) for index 0..count-1, each worker starting on
+     * its own contiguous block of indices and stealing from the far end of
+     * the others' blocks once it runs dry. worker is below size() + 1 and
+     * never runs two tasks at once, so it can pick per-worker state.
+     * Returns once every index is done.
+     */
+    void work_stealing_for(int count, const std::function<void(int, int)> &task);
+
+private:
+    void worker_loop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()> > tasks;
+    std::mutex queue_mutex;
+    std::condition_variable task_ready;
+    bool stopping;
+};
+
+#endif
@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <opencv2/core/core.hpp>
+#include "eye_center.h"
+#include "gradient_voting.h"
+#include "synthetic_eye.h"
+
+using namespace std;
+using namespace cv;
+
+/*
+ * Speed and accuracy of every locator mode on synthetic eyes with known
+ * pupil centers. The reference engine is the golden baseline: each mode is
+ * accepted only if its pixel error is no worse than the reference's by more
+ * than the tolerance, and the reference itself has to reproduce the golden
+ * file's centers. The default dataset is checked against the committed
+ * golden file unless --golden names another one. A rejected mode exits 1,
+ * --report-only only reports it. A drifted reference exits 1 only when the
+ * golden file was written with this OpenCV version, since anti-aliased
+ * drawing, blurring and resizing differ slightly between versions.
+ *
+ * Syntax: Eye_Tracking_Validate [--dataset DIR] [--samples N] [--seed SEED]
+ *                               [--golden FILE] [--write-golden FILE]
+ *                               [--tolerance PIXELS] [--detail] [--report-only]
+ *                               [--json FILE]
+ */
+
+// reference centers of the default dataset, regenerate with --write-golden
+static const string kDefaultGolden = "golden_data/synthetic_eyes.csv";
+static const int kDefaultSamples = 4;
+static const uint64_t kDefaultSeed = 1;
+
+typedef struct {
+    string name;
+    LocatorSettingsSt settings;
+} LocatorMode;
+
+typedef struct {
+    string mode;
+    vector<Point> centers;
+    vector<double> errors;
+    double nsPerPatch = 0.0;
+    double mean = 0.0, median = 0.0, p90 = 0.0, p99 = 0.0, max = 0.0;
+    // patches within a pixel of the truth, and identical to the golden baseline
+    double withinPixel = 0.0;
+    double agreement = 0.0;
+    bool accepted = true;
+} ModeResult;
+
+static vector<LocatorMode> locator_modes() {
+    vector<LocatorMode> modes;
+    const LocatorSettingsSt defaults = LocatorSettingsSt();
+    VoteEngine engines[] = {VOTE_REFERENCE, VOTE_SCALAR, resolve_vote_engine(VOTE_AUTO)};
+    for (VoteEngine engine : engines) {
+        LocatorMode mode = {vote_engine_name(engine), defaults};
+        mode.settings.voteEngine = engine;
+        modes.push_back(mode);
+    }
+    LocatorMode mode = {"auto", defaults};
+    modes.push_back(mode);
+    mode.name = "sparse";
+    mode.settings.sparseGradients = true;
+    modes.push_back(mode);
+    mode = {"pyramid", defaults};
+    mode.settings.pyramid = true;
+    modes.push_back(mode);
+    mode = {"fft", defaults};
+    mode.settings.fftObjective = true;
+    modes.push_back(mode);
+    mode = {"weighted", defaults};
+    mode.settings.darkWeight = true;
+    modes.push_back(mode);
+    mode = {"parallel", defaults};
+    mode.settings.parallelVotes = true;
+    modes.push_back(mode);
+    return modes;
+}
+
+// q quantile of sorted values, nearest rank
+static double quantile(const vector<double> &sorted, double q) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = (size_t)ceil(q * sorted.size());
+    return sorted[min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+static ModeResult run_mode(const LocatorMode &mode, const vector<SyntheticEye> &eyes) {
+    ModeResult r;
+    r.mode = mode.name;
+    LocatorSettings = mode.settings;
+    r.centers.resize(eyes.size());
+    r.errors.resize(eyes.size());
+
+    // one untimed call so the workspace and tables are warm
+    find_centers(eyes[0].image, Rect(0, 0, eyes[0].image.cols, eyes[0].image.rows));
+    double start = getTickCount();
+    for (size_t i = 0; i < eyes.size(); i++) {
+        r.centers[i] = find_centers(eyes[i].image, Rect(0, 0, eyes[i].image.cols, eyes[i].image.rows));
+    }
+    double elapsed = (getTickCount() - start) / getTickFrequency();
+    r.nsPerPatch = elapsed * 1e9 / eyes.size();
+
+    int within = 0;
+    for (size_t i = 0; i < eyes.size(); i++) {
+        Point2f delta = Point2f((float)r.centers[i].x, (float)r.centers[i].y) - eyes[i].center;
+        r.errors[i] = sqrt(delta.x * delta.x + delta.y * delta.y);
+        r.mean += r.errors[i];
+        within += r.errors[i] <= 1.0 ? 1 : 0;
+    }
+    r.mean /= eyes.size();
+    r.withinPixel = (double)within / eyes.size();
+
+    vector<double> sorted = r.errors;
+    sort(sorted.begin(), sorted.end());
+    r.median = quantile(sorted, 0.5);
+    r.p90 = quantile(sorted, 0.9);
+    r.p99 = quantile(sorted, 0.99);
+    r.max = sorted.back();
+    return r;
+}
+
+/*
+ * Golden files list the reference engine's center for each patch as
+ * file,x,y after # comment lines, "# opencv VERSION" names the OpenCV
+ * version that wrote them
+ */
+static const string kGoldenVersionTag = "# opencv ";
+
+static bool read_golden(const string &file_name, const vector<SyntheticEye> &eyes, vector<Point> &centers,
+                        string &version) {
+    ifstream in(file_name.c_str());
+    if (!in) {
+        return false;
+    }
+    centers.clear();
+    version.clear();
+    string line;
+    while (getline(in, line)) {
+        if (line.compare(0, kGoldenVersionTag.size(), kGoldenVersionTag) == 0) {
+            version = line.substr(kGoldenVersionTag.size());
+            version.erase(version.find_last_not_of(" \t\r") + 1);
+            continue;
+        }
+        if (line.find_first_not_of(" \t\r") == string::npos || line[0] == '#') {
+            continue;
+        }
+        replace(line.begin(), line.end(), ',', ' ');
+        stringstream ss(line);
+        string name;
+        Point p;
+        if (!(ss >> name >> p.x >> p.y) || centers.size() >= eyes.size() || name != eyes[centers.size()].name) {
+            return false;
+        }
+        centers.push_back(p);
+    }
+    return centers.size() == eyes.size();
+}
+
+static bool write_golden(const string &file_name, const vector<SyntheticEye> &eyes, const vector<Point> &centers) {
+    ofstream out(file_name.c_str());
+    out << "# reference engine centers, written by Eye_Tracking_Validate --write-golden\n";
+    out << kGoldenVersionTag << CV_VERSION << "\n";
+    for (size_t i = 0; i < eyes.size() && out; i++) {
+        out << eyes[i].name << "," << centers[i].x << "," << centers[i].y << "\n";
+    }
+    return (bool)out;
+}
+
+/*
+ * Mean error of r for each value of one spec field
+ */
+template <typename Key>
+static void print_breakdown(const string &field, const ModeResult &r, const vector<SyntheticEye> &eyes,
+                            Key (*key)(const SyntheticEyeSpec &)) {
+    vector<pair<Key, pair<double, int> > > groups;
+    for (size_t i = 0; i < eyes.size(); i++) {
+        Key k = key(eyes[i].spec);
+        size_t g = 0;
+        while (g < groups.size() && groups[g].first != k) {
+            g++;
+        }
+        if (g == groups.size()) {
+            groups.push_back(make_pair(k, make_pair(0.0, 0)));
+        }
+        groups[g].second.first += r.errors[i];
+        groups[g].second.second++;
+    }
+    cout << "  " << field << ":";
+    for (const auto &g : groups) {
+        cout << " " << g.first << "=" << g.second.first / g.second.second;
+    }
+    cout << endl;
+}
+
+static int spec_width(const SyntheticEyeSpec &s) { return s.width; }
+static double spec_contrast(const SyntheticEyeSpec &s) { return s.contrast; }
+static double spec_noise(const SyntheticEyeSpec &s) { return s.noise; }
+static int spec_glint(const SyntheticEyeSpec &s) { return s.glint ? 1 : 0; }
+static double spec_eyelid(const SyntheticEyeSpec &s) { return s.eyelid; }
+
+static void write_json(ostream &out, const vector<ModeResult> &results, double tolerance) {
+    out << "{\"tolerance\": " << tolerance << ", \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const ModeResult &r = results[i];
+        out << "  {\"mode\": \"" << r.mode << "\", \"ns_per_patch\": " << r.nsPerPatch << ", \"mean\": " << r.mean
+            << ", \"median\": " << r.median << ", \"p90\": " << r.p90 << ", \"p99\": " << r.p99
+            << ", \"max\": " << r.max << ", \"within_pixel\": " << r.withinPixel
+            << ", \"golden_agreement\": " << r.agreement << ", \"accepted\": " << (r.accepted ? "true" : "false")
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]}\n";
+}
+
+int main(int argc, char* argv[]) {
+    string dataset_dir, golden_name, write_golden_name, json_name;
+    int samples = kDefaultSamples;
+    uint64_t seed = kDefaultSeed;
+    double tolerance = 0.5;
+    bool detail = false, report_only = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && string("--dataset").compare(argv[i]) == 0) {
+            dataset_dir = argv[++i];
+        } else if (i + 1 < argc && string("--samples").compare(argv[i]) == 0) {
+            samples = max(1, atoi(argv[++i]));
+        } else if (i + 1 < argc && string("--seed").compare(argv[i]) == 0) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && string("--golden").compare(argv[i]) == 0) {
+            golden_name = argv[++i];
+        } else if (i + 1 < argc && string("--write-golden").compare(argv[i]) == 0) {
+            write_golden_name = argv[++i];
+        } else if (i + 1 < argc && string("--tolerance").compare(argv[i]) == 0) {
+            tolerance = atof(argv[++i]);
+        } else if (string("--detail").compare(argv[i]) == 0) {
+            detail = true;
+        } else if (string("--report-only").compare(argv[i]) == 0) {
+            report_only = true;
+        } else if (i + 1 < argc && string("--json").compare(argv[i]) == 0) {
+            json_name = argv[++i];
+        } else {
+            cerr << "ERROR: No argument <" << argv[i] << "> exists!\n" <<
+                    "Syntax Eye_Tracking_Validate [--dataset DIR] [--samples N] [--seed SEED] [--golden FILE] " <<
+                    "[--write-golden FILE] [--tolerance PIXELS] [--detail] [--report-only] [--json FILE]";
+            exit(1);
+        }
+    }
+
+    // the committed golden file only describes the default dataset, and is
+    // not held against a run that is writing its replacement
+    if (golden_name.empty() && write_golden_name.empty() && dataset_dir.empty() && samples == kDefaultSamples &&
+        seed == kDefaultSeed) {
+        golden_name = kDefaultGolden;
+    } else if (golden_name.empty()) {
+        cout << "No golden file for this dataset, the reference engine is only compared with itself" << endl;
+    }
+
+    vector<SyntheticEye> eyes;
+    if (dataset_dir.empty()) {
+        synthetic_eye_dataset(samples, seed, eyes);
+    } else if (!read_synthetic_eyes(dataset_dir, eyes)) {
+        cerr << "Failed to read the synthetic eyes in <" << dataset_dir << ">!";
+        exit(1);
+    }
+    if (eyes.empty()) {
+        cerr << "ERROR: no synthetic eyes to validate against!";
+        exit(1);
+    }
+    cout << eyes.size() << " synthetic eyes" << endl;
+
+    const LocatorSettingsSt defaults = LocatorSettings;
+    vector<LocatorMode> modes = locator_modes();
+    vector<ModeResult> results;
+    for (const LocatorMode &mode : modes) {
+        results.push_back(run_mode(mode, eyes));
+    }
+    LocatorSettings = defaults;
+
+    // the reference engine runs first and is the baseline everything else is held to
+    const ModeResult &reference = results[0];
+    vector<Point> golden = reference.centers;
+    string golden_version;
+    int drifted = 0;
+    if (!golden_name.empty()) {
+        if (!read_golden(golden_name, eyes, golden, golden_version)) {
+            cerr << "Failed to read <" << golden_name << "> as a golden file for this dataset!";
+            exit(1);
+        }
+        for (size_t i = 0; i < eyes.size(); i++) {
+            drifted += reference.centers[i] != golden[i] ? 1 : 0;
+        }
+    }
+    if (!write_golden_name.empty() && !write_golden(write_golden_name, eyes, reference.centers)) {
+        cerr << "Failed to write <" << write_golden_name << ">!";
+        exit(1);
+    }
+
+    int rejected = 0;
+    for (ModeResult &r : results) {
+        int agree = 0;
+        for (size_t i = 0; i < eyes.size(); i++) {
+            agree += r.centers[i] == golden[i] ? 1 : 0;
+        }
+        r.agreement = (double)agree / eyes.size();
+        r.accepted = r.mean <= reference.mean + tolerance && r.p90 <= reference.p90 + tolerance;
+        rejected += r.accepted ? 0 : 1;
+
+        cout << r.mode << ": " << r.nsPerPatch << " ns/patch, error mean " << r.mean << " median " << r.median
+             << " p90 " << r.p90 << " p99 " << r.p99 << " max " << r.max << " px, "
+             << r.withinPixel * 100 << "% within 1 px, " << r.agreement * 100 << "% golden, "
+             << (r.accepted ? "accepted" : "REJECTED") << endl;
+        if (detail) {
+            print_breakdown("width", r, eyes, spec_width);
+            print_breakdown("contrast", r, eyes, spec_contrast);
+            print_breakdown("noise", r, eyes, spec_noise);
+            print_breakdown("glint", r, eyes, spec_glint);
+            print_breakdown("eyelid", r, eyes, spec_eyelid);
+        }
+    }
+
+    if (!json_name.empty()) {
+        ofstream json(json_name.c_str());
+        if (!json) {
+            cerr << "Failed to open <" << json_name << ">!";
+            exit(1);
+        }
+        write_json(json, results, tolerance);
+    }
+
+    if (drifted > 0 && golden_version != CV_VERSION) {
+        cerr << "WARNING: the reference engine moved " << drifted << " of " << eyes.size()
+             << " centers away from <" << golden_name << ">, which was written with OpenCV "
+             << (golden_version.empty() ? string("unknown") : golden_version) << " and not this build's "
+             << CV_VERSION << ", regenerate it with --write-golden" << endl;
+    } else if (drifted > 0) {
+        cerr << "ERROR: the reference engine moved " << drifted << " of " << eyes.size()
+             << " centers away from <" << golden_name << ">!" << endl;
+        return 1;
+    }
+    if (rejected > 0 && !report_only) {
+        cerr << "ERROR: " << rejected << " of " << results.size() << " modes were rejected!" << endl;
+        return 1;
+    }
+    return 0;
+}